@@ -0,0 +1,233 @@
+#ifdef PLATFORM_WINDOWS
+    #include <windows.h>
+#elif PLATFORM_LINUX
+    #include <pthread.h>
+#endif
+
+#include "actor_commands.h"
+#include "particles.h"
+#include "audio.h"
+#include "debug.h"
+#include <thread>
+#include <condition_variable>
+
+struct ActorCommandBuffer {
+	u32 count;
+	ActorCommand commands[MAX_ACTOR_COMMANDS_PER_BUFFER];
+};
+
+struct ActorWorkerTask {
+	Actor** ppActors;
+	u32 count;
+	u32 bufferIndex;
+};
+
+// One buffer per task so commands can be applied in actor order regardless of which thread ran the task
+static ActorCommandBuffer g_commandBuffers[MAX_ACTOR_WORKER_COUNT];
+static thread_local ActorCommandBuffer* t_pCommandBuffer = nullptr;
+
+// Threading
+static ActorWorkerTask g_workerTasks[MAX_ACTOR_WORKER_COUNT];
+static u32 g_activeTaskCount = 0;
+
+static u32 g_workerCount = 0;
+static u32 g_activeWorkers = 0;
+static std::thread g_workerThreads[MAX_ACTOR_WORKER_COUNT];
+
+static std::condition_variable g_workerCondition;
+static std::condition_variable g_allWorkDoneCondition;
+static std::mutex g_workerMutex;
+static bool g_stopWorkers = false;
+
+static void RunTask(const ActorWorkerTask& task) {
+	ActorCommandBuffer* pBuffer = &g_commandBuffers[task.bufferIndex];
+	pBuffer->count = 0;
+	t_pCommandBuffer = pBuffer;
+
+	for (u32 i = 0; i < task.count; i++) {
+		Actor* pActor = task.ppActors[i];
+		if (pActor->flags.pendingRemoval) {
+			continue;
+		}
+
+		Game::actorUpdateTable[pActor->type][pActor->subtype](pActor);
+	}
+
+	t_pCommandBuffer = nullptr;
+}
+
+static void WorkerLoop() {
+#ifdef PLATFORM_WINDOWS
+	SetThreadDescription(GetCurrentThread(), L"ActorWorker");
+#elif PLATFORM_LINUX
+	pthread_setname_np(pthread_self(), "ActorWorker");
+#endif
+
+	while (true) {
+		ActorWorkerTask task;
+		{
+			std::unique_lock<std::mutex> lock(g_workerMutex);
+			while (g_activeTaskCount == 0 && !g_stopWorkers) {
+				g_workerCondition.wait(lock);
+			}
+
+			if (g_stopWorkers) {
+				return;
+			}
+
+			task = g_workerTasks[--g_activeTaskCount];
+			g_activeWorkers++;
+		}
+
+		RunTask(task);
+
+		{
+			std::unique_lock<std::mutex> lock(g_workerMutex);
+			g_activeWorkers--;
+			if (g_activeWorkers == 0 && g_activeTaskCount == 0) {
+				g_allWorkDoneCondition.notify_all();
+			}
+		}
+	}
+}
+
+static void InitWorkers() {
+	// Leave one core for the main thread, which also runs a task
+	const u32 hardwareThreads = std::thread::hardware_concurrency();
+	g_workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	if (g_workerCount > MAX_ACTOR_WORKER_COUNT - 1) {
+		g_workerCount = MAX_ACTOR_WORKER_COUNT - 1;
+	}
+
+	g_stopWorkers = false;
+	for (u32 i = 0; i < g_workerCount; i++) {
+		g_workerThreads[i] = std::thread(WorkerLoop);
+	}
+}
+
+static void ApplyCommand(const ActorCommand& command) {
+	switch (command.type) {
+	case ACTOR_COMMAND_SPAWN_ACTOR: {
+		Game::SpawnActor(ActorPrototypeHandle(command.id), command.position, command.velocity);
+		break;
+	}
+	case ACTOR_COMMAND_SPAWN_EFFECT: {
+		Game::SpawnEffect(ActorPrototypeHandle(command.id), command.position, command.velocity);
+		break;
+	}
+	case ACTOR_COMMAND_REMOVE_ACTOR: {
+		Actor* pActor = Game::GetActors()->Get(ActorHandle(command.id));
+		if (pActor) {
+			pActor->flags.pendingRemoval = true;
+		}
+		break;
+	}
+	case ACTOR_COMMAND_DAMAGE_PLAYER: {
+		// Another command may have already killed or damaged the player
+		Actor* pPlayer = Game::GetPlayer();
+		if (pPlayer && !Game::PlayerInvulnerable(pPlayer)) {
+			Game::PlayerTakeDamage(pPlayer, command.damage, command.position);
+		}
+		break;
+	}
+	case ACTOR_COMMAND_PERSIST_DATA: {
+		Game::SetPersistedActorData(command.id, command.persistData);
+		break;
+	}
+	case ACTOR_COMMAND_ADD_EXP: {
+		Game::AddPlayerExp(command.value);
+		break;
+	}
+	case ACTOR_COMMAND_PLAY_SFX: {
+		Audio::PlaySFX(SoundHandle(command.id), command.maxPitchShift);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+#pragma region Public API
+bool Game::ActorCommandsDeferred() {
+	return t_pCommandBuffer != nullptr;
+}
+
+void Game::PushActorCommand(const ActorCommand& command) {
+	ActorCommandBuffer* pBuffer = t_pCommandBuffer;
+	if (pBuffer == nullptr) {
+		return ApplyCommand(command);
+	}
+
+	if (pBuffer->count >= MAX_ACTOR_COMMANDS_PER_BUFFER) {
+		DEBUG_WARN("Actor command buffer full, dropping command of type %d\n", command.type);
+		return;
+	}
+
+	pBuffer->commands[pBuffer->count++] = command;
+}
+
+void Game::RemoveActorDeferred(const ActorHandle& handle) {
+	PushActorCommand({ .type = ACTOR_COMMAND_REMOVE_ACTOR, .id = handle.Raw() });
+}
+
+void Game::PlayActorSFX(SoundHandle soundHandle, s8 maxPitchShift) {
+	PushActorCommand({ .type = ACTOR_COMMAND_PLAY_SFX, .id = soundHandle.id, .maxPitchShift = maxPitchShift });
+}
+
+void Game::UpdateActorsParallel(Actor** ppActors, u32 count) {
+	if (count == 0) {
+		return;
+	}
+
+	if (g_workerCount == 0) {
+		InitWorkers();
+	}
+
+	// Contiguous chunks, so applying the buffers in task order matches actor order
+	const u32 taskCount = g_workerCount + 1;
+	const u32 actorsPerTask = (count + taskCount - 1) / taskCount;
+
+	ActorWorkerTask mainThreadTask{ ppActors, actorsPerTask < count ? actorsPerTask : count, 0 };
+	u32 usedBufferCount = 1;
+	{
+		std::unique_lock<std::mutex> lock(g_workerMutex);
+		for (u32 offset = mainThreadTask.count; offset < count; offset += actorsPerTask) {
+			const u32 remaining = count - offset;
+			g_workerTasks[g_activeTaskCount++] = { ppActors + offset, remaining < actorsPerTask ? remaining : actorsPerTask, usedBufferCount++ };
+		}
+		g_workerCondition.notify_all();
+	}
+
+	RunTask(mainThreadTask);
+
+	{
+		std::unique_lock<std::mutex> lock(g_workerMutex);
+		while (g_activeWorkers > 0 || g_activeTaskCount > 0) {
+			g_allWorkDoneCondition.wait(lock);
+		}
+	}
+
+	// Sync point
+	for (u32 i = 0; i < usedBufferCount; i++) {
+		const ActorCommandBuffer& buffer = g_commandBuffers[i];
+		for (u32 c = 0; c < buffer.count; c++) {
+			ApplyCommand(buffer.commands[c]);
+		}
+	}
+}
+
+void Game::FreeActorWorkers() {
+	{
+		std::unique_lock<std::mutex> lock(g_workerMutex);
+		g_stopWorkers = true;
+	}
+	g_workerCondition.notify_all();
+
+	for (u32 i = 0; i < g_workerCount; i++) {
+		if (g_workerThreads[i].joinable()) {
+			g_workerThreads[i].join();
+		}
+	}
+	g_workerCount = 0;
+}
+#pragma endregion
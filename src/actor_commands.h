@@ -0,0 +1,45 @@
+#pragma once
+#include "typedef.h"
+#include "actors.h"
+#include "game_state.h"
+
+constexpr u32 MAX_ACTOR_WORKER_COUNT = 8;
+constexpr u32 MAX_ACTOR_COMMANDS_PER_BUFFER = 1024;
+
+enum ActorCommandType : u8 {
+	ACTOR_COMMAND_SPAWN_ACTOR,
+	ACTOR_COMMAND_SPAWN_EFFECT,
+	ACTOR_COMMAND_REMOVE_ACTOR,
+	ACTOR_COMMAND_DAMAGE_PLAYER,
+	ACTOR_COMMAND_PERSIST_DATA,
+	ACTOR_COMMAND_ADD_EXP,
+	ACTOR_COMMAND_PLAY_SFX,
+};
+
+struct ActorCommand {
+	// Defaults let commands be built with designated initializers that only name the fields their type uses
+	ActorCommandType type = ACTOR_COMMAND_SPAWN_ACTOR;
+	u64 id = 0; // Prototype, actor handle, persist id or sound, depending on type
+	glm::vec2 position = glm::vec2(0.0f);
+	glm::vec2 velocity = glm::vec2(0.0f);
+	Damage damage = {};
+	s16 value = 0;
+	s8 maxPitchShift = 0;
+	PersistedActorData persistData = {};
+};
+
+// Actor updates running on worker threads can't touch other actors or global game state directly.
+// Instead, SpawnActor, SpawnEffect, SetPersistedActorData, PlayerTakeDamage and AddPlayerExp record commands
+// into the calling thread's buffer, which are applied in buffer order on the main thread after the update pass
+namespace Game {
+	bool ActorCommandsDeferred();
+	void PushActorCommand(const ActorCommand& command);
+
+	void RemoveActorDeferred(const ActorHandle& handle);
+	// Plays immediately on the main thread, deferred on workers
+	void PlayActorSFX(SoundHandle soundHandle, s8 maxPitchShift = 2);
+
+	// Updates the actors across the worker pool and applies the recorded commands in actor order
+	void UpdateActorsParallel(Actor** ppActors, u32 count);
+	void FreeActorWorkers();
+}
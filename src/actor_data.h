@@ -383,9 +383,20 @@ union ActorData {
 	LootSpawnerData lootSpawner;
 };
 
+enum ActorActivationMode : u8 {
+	ACTOR_ACTIVATION_DEFAULT, // Determined by subtype
+	ACTOR_ACTIVATION_ALWAYS, // Updated even when far from the viewport
+	ACTOR_ACTIVATION_REGION, // Sleeps when outside the activation region
+
+	ACTOR_ACTIVATION_COUNT
+};
+
+constexpr const char* ACTOR_ACTIVATION_NAMES[ACTOR_ACTIVATION_COUNT] = { "Default", "Always", "Region" };
+
 struct ActorPrototype {
 	TActorType type;
 	TActorSubtype subtype;
+	u8 activation;
 
 	AABB hitbox;
 	ActorData data;
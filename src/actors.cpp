@@ -4,7 +4,10 @@
 #include "random.h"
 #include "asset_manager.h"
 #include "collision.h"
+#include "particles.h"
+#include "actor_commands.h"
 #include <gtc/constants.hpp>
+#include <chrono>
 
 // TODO: Define in editor in game settings or similar
 constexpr ActorPrototypeHandle dmgNumberPrototypeId(3893478668273870712);
@@ -12,13 +15,146 @@ constexpr ActorPrototypeHandle dmgNumberPrototypeId(3893478668273870712);
 static Pool<Actor, MAX_DYNAMIC_ACTOR_COUNT> actors;
 static Pool<ActorHandle, MAX_DYNAMIC_ACTOR_COUNT> actorRemoveList;
 
+// Flat (type, subtype) index used to group actors for batched dispatch
+constexpr u32 actorSubtypeCounts[ACTOR_TYPE_COUNT] = {
+	PLAYER_TYPE_COUNT,
+	ENEMY_TYPE_COUNT,
+	BULLET_TYPE_COUNT,
+	PICKUP_TYPE_COUNT,
+	EFFECT_TYPE_COUNT,
+	INTERACTABLE_TYPE_COUNT,
+	SPAWNER_TYPE_COUNT,
+};
+
+constexpr u32 GetActorGroupOffset(u32 type) {
+	u32 offset = 0;
+	for (u32 i = 0; i < type; i++) {
+		offset += actorSubtypeCounts[i];
+	}
+	return offset;
+}
+
+constexpr u32 actorGroupOffsets[ACTOR_TYPE_COUNT] = {
+	GetActorGroupOffset(ACTOR_TYPE_PLAYER),
+	GetActorGroupOffset(ACTOR_TYPE_ENEMY),
+	GetActorGroupOffset(ACTOR_TYPE_BULLET),
+	GetActorGroupOffset(ACTOR_TYPE_PICKUP),
+	GetActorGroupOffset(ACTOR_TYPE_EFFECT),
+	GetActorGroupOffset(ACTOR_TYPE_INTERACTABLE),
+	GetActorGroupOffset(ACTOR_TYPE_SPAWNER),
+};
+constexpr u32 ACTOR_GROUP_COUNT = GetActorGroupOffset(ACTOR_TYPE_COUNT);
+
+// Actors outside the viewport expanded by this margin (in metatiles) go to sleep
+static glm::vec2 activationMargin = { VIEWPORT_WIDTH_METATILES / 2, VIEWPORT_HEIGHT_METATILES / 2 };
+
+// Used when the prototype activation mode is ACTOR_ACTIVATION_DEFAULT
+constexpr bool playerAlwaysActive[PLAYER_TYPE_COUNT] = { true, true };
+constexpr bool enemyAlwaysActive[ENEMY_TYPE_COUNT] = { false, false, false };
+constexpr bool bulletAlwaysActive[BULLET_TYPE_COUNT] = { true, true };
+constexpr bool pickupAlwaysActive[PICKUP_TYPE_COUNT] = { false, false, false };
+constexpr bool effectAlwaysActive[EFFECT_TYPE_COUNT] = { true, true, true };
+constexpr bool interactableAlwaysActive[INTERACTABLE_TYPE_COUNT] = { true, false };
+constexpr bool spawnerAlwaysActive[SPAWNER_TYPE_COUNT] = { true, true, true };
+
+constexpr bool const* actorAlwaysActiveTable[ACTOR_TYPE_COUNT] = {
+	playerAlwaysActive,
+	enemyAlwaysActive,
+	bulletAlwaysActive,
+	pickupAlwaysActive,
+	effectAlwaysActive,
+	interactableAlwaysActive,
+	spawnerAlwaysActive,
+};
+
+// Subtypes whose update only writes to the actor itself and routes other side effects through actor commands.
+// Run on worker threads after the serial pass when parallel update is enabled
+constexpr bool playerParallelSafe[PLAYER_TYPE_COUNT] = { false, false };
+constexpr bool enemyParallelSafe[ENEMY_TYPE_COUNT] = { false, false, false };
+constexpr bool bulletParallelSafe[BULLET_TYPE_COUNT] = { false, false };
+constexpr bool pickupParallelSafe[PICKUP_TYPE_COUNT] = { true, false, false };
+constexpr bool effectParallelSafe[EFFECT_TYPE_COUNT] = { true, true, true };
+constexpr bool interactableParallelSafe[INTERACTABLE_TYPE_COUNT] = { false, false };
+constexpr bool spawnerParallelSafe[SPAWNER_TYPE_COUNT] = { false, false, false };
+
+constexpr bool const* actorParallelSafeTable[ACTOR_TYPE_COUNT] = {
+	playerParallelSafe,
+	enemyParallelSafe,
+	bulletParallelSafe,
+	pickupParallelSafe,
+	effectParallelSafe,
+	interactableParallelSafe,
+	spawnerParallelSafe,
+};
+
+static bool parallelUpdateEnabled = false;
+static Actor* parallelActors[MAX_DYNAMIC_ACTOR_COUNT];
+static u32 parallelActorCount = 0;
+
+static bool profilingEnabled = false;
+static ActorProfileTimes profileTimes{};
+static u32 profileDepth[ACTOR_PROFILE_CATEGORY_COUNT]{};
+
+// Only the outermost scope of each category is timed, so nested queries aren't counted twice
+struct ActorProfileScope {
+	ActorProfileCategory category;
+	bool counted;
+	bool timed;
+	std::chrono::steady_clock::time_point start;
+
+	ActorProfileScope(ActorProfileCategory category) : category(category), counted(false), timed(false) {
+		// Worker threads aren't profiled
+		if (!profilingEnabled || Game::ActorCommandsDeferred()) {
+			return;
+		}
+
+		counted = true;
+		if (profileDepth[category]++ == 0) {
+			timed = true;
+			start = std::chrono::steady_clock::now();
+		}
+	}
+
+	~ActorProfileScope() {
+		if (!counted) {
+			return;
+		}
+
+		profileDepth[category]--;
+		if (timed) {
+			const std::chrono::duration<r64> elapsed = std::chrono::steady_clock::now() - start;
+			profileTimes.seconds[category] += elapsed.count();
+			profileTimes.calls[category]++;
+		}
+	}
+};
+
+#define ACTOR_PROFILE_SCOPE(CATEGORY) ActorProfileScope __profileScope(CATEGORY)
+
+static ActorDispatchMode dispatchMode = ACTOR_DISPATCH_POOL_ORDER;
+static Actor* unsortedActors[MAX_DYNAMIC_ACTOR_COUNT];
+static Actor* sortedActors[MAX_DYNAMIC_ACTOR_COUNT];
+static u32 actorGroupStart[ACTOR_GROUP_COUNT + 1];
+
 PoolHandle<Actor> playerHandle;
 
+static bool ResolveAlwaysActive(const ActorPrototype* pPrototype) {
+	switch (pPrototype->activation) {
+	case ACTOR_ACTIVATION_ALWAYS:
+		return true;
+	case ACTOR_ACTIVATION_REGION:
+		return false;
+	default:
+		return actorAlwaysActiveTable[pPrototype->type][pPrototype->subtype];
+	}
+}
+
 static void InitializeActor(Actor* pActor) {
 	pActor->flags.facingDir = ACTOR_FACING_RIGHT;
 	pActor->flags.inAir = true;
 	pActor->flags.active = true;
 	pActor->flags.pendingRemoval = false;
+	pActor->flags.sleeping = false;
 
 	pActor->initialPosition = pActor->position;
 	pActor->initialVelocity = pActor->velocity;
@@ -53,6 +189,7 @@ Actor* Game::SpawnActor(const RoomActor* pTemplate, u32 roomId) {
 		.hitbox = pPrototype->hitbox,
 		.__temp_actorPrototypeHandle = pTemplate->prototypeHandle,
 	};
+	actor.flags.alwaysActive = ResolveAlwaysActive(pPrototype);
 
 	InitializeActor(&actor);
 	const ActorHandle handle = actors.Add(actor);
@@ -64,6 +201,11 @@ Actor* Game::SpawnActor(const RoomActor* pTemplate, u32 roomId) {
 	return actors.Get(handle);
 }
 Actor* Game::SpawnActor(const ActorPrototypeHandle& prototypeHandle, const glm::vec2& position, const glm::vec2& velocity) {
+	if (ActorCommandsDeferred()) {
+		PushActorCommand({ .type = ACTOR_COMMAND_SPAWN_ACTOR, .id = prototypeHandle.id, .position = position, .velocity = velocity });
+		return nullptr;
+	}
+
 	if (actors.Count() >= MAX_DYNAMIC_ACTOR_COUNT || prototypeHandle == ActorPrototypeHandle::Null()) {
 		return nullptr;
 	}
@@ -83,6 +225,7 @@ Actor* Game::SpawnActor(const ActorPrototypeHandle& prototypeHandle, const glm::
 		.hitbox = pPrototype->hitbox,
 		.__temp_actorPrototypeHandle = prototypeHandle,
 	};
+	actor.flags.alwaysActive = ResolveAlwaysActive(pPrototype);
 
 	InitializeActor(&actor);
 	const ActorHandle handle = actors.Add(actor);
@@ -99,14 +242,35 @@ void Game::ClearActors() {
 	actorRemoveList.Clear();
 }
 
-const Animation* Game::GetActorCurrentAnim(const Actor* pActor) {
-	const ActorPrototype* pPrototype = AssetManager::GetAsset(pActor->__temp_actorPrototypeHandle);
-	if (!pPrototype) {
-		return nullptr;
+static void ResolveActorAssets(const Actor* pActor) {
+	const ActorDrawState& drawState = pActor->drawState;
+	const u32 generation = AssetManager::GetGeneration();
+	if (drawState.assetGeneration == generation && drawState.resolvedAnimIndex == drawState.animIndex) {
+		return;
 	}
 
-	const AnimationHandle& currentAnimId = pPrototype->GetAnimations()[pActor->drawState.animIndex];
-	return AssetManager::GetAsset(currentAnimId);
+	if (drawState.assetGeneration != generation) {
+		drawState.pPrototype = AssetManager::GetAsset(pActor->__temp_actorPrototypeHandle);
+	}
+
+	drawState.pCurrentAnim = nullptr;
+	if (drawState.pPrototype && drawState.animIndex < drawState.pPrototype->animCount) {
+		const AnimationHandle& currentAnimId = drawState.pPrototype->GetAnimations()[drawState.animIndex];
+		drawState.pCurrentAnim = AssetManager::GetAsset(currentAnimId);
+	}
+
+	drawState.assetGeneration = generation;
+	drawState.resolvedAnimIndex = drawState.animIndex;
+}
+
+const ActorPrototype* Game::GetActorPrototype(const Actor* pActor) {
+	ResolveActorAssets(pActor);
+	return pActor->drawState.pPrototype;
+}
+
+const Animation* Game::GetActorCurrentAnim(const Actor* pActor) {
+	ResolveActorAssets(pActor);
+	return pActor->drawState.pCurrentAnim;
 }
 
 bool Game::ActorValid(const Actor* pActor) {
@@ -118,16 +282,17 @@ bool Game::ActorsColliding(const Actor* pActor, const Actor* pOther) {
 }
 
 void Game::ForEachActorCollision(Actor* pActor, TActorType type, ActorCollisionCallbackFn callback) {
+	ACTOR_PROFILE_SCOPE(ACTOR_PROFILE_QUERIES);
+
 	if (!ActorValid(pActor)) {
 		return;
 	}
 
-	for (u32 i = 0; i < actors.Count(); i++)
+	for (Actor& other : actors)
 	{
-		ActorHandle handle = actors.GetHandle(i);
-		Actor* pOther = actors.Get(handle);
+		Actor* pOther = &other;
 
-		if (!ActorValid(pOther)) {
+		if (!ActorValid(pOther) || pOther->flags.sleeping) {
 			continue;
 		}
 
@@ -141,16 +306,17 @@ void Game::ForEachActorCollision(Actor* pActor, TActorType type, ActorCollisionC
 	}
 }
 void Game::ForEachActorCollision(Actor* pActor, ActorFilterFn filter, ActorCollisionCallbackFn callback) {
+	ACTOR_PROFILE_SCOPE(ACTOR_PROFILE_QUERIES);
+
 	if (!ActorValid(pActor)) {
 		return;
 	}
 
-	for (u32 i = 0; i < actors.Count(); i++)
+	for (Actor& other : actors)
 	{
-		ActorHandle handle = actors.GetHandle(i);
-		Actor* pOther = actors.Get(handle);
+		Actor* pOther = &other;
 
-		if (!ActorValid(pOther)) {
+		if (!ActorValid(pOther) || pOther->flags.sleeping) {
 			continue;
 		}
 
@@ -164,16 +330,17 @@ void Game::ForEachActorCollision(Actor* pActor, ActorFilterFn filter, ActorColli
 	}
 }
 Actor* Game::GetFirstActorCollision(const Actor* pActor, TActorType type) {
+	ACTOR_PROFILE_SCOPE(ACTOR_PROFILE_QUERIES);
+
 	if (!ActorValid(pActor)) {
 		return nullptr;
 	}
 
-	for (u32 i = 0; i < actors.Count(); i++)
+	for (Actor& other : actors)
 	{
-		ActorHandle handle = actors.GetHandle(i);
-		Actor* pOther = actors.Get(handle);
+		Actor* pOther = &other;
 
-		if (!ActorValid(pOther)) {
+		if (!ActorValid(pOther) || pOther->flags.sleeping) {
 			continue;
 		}
 
@@ -189,16 +356,17 @@ Actor* Game::GetFirstActorCollision(const Actor* pActor, TActorType type) {
 	return nullptr;
 }
 Actor* Game::GetFirstActorCollision(const Actor* pActor, ActorFilterFn filter) {
+	ACTOR_PROFILE_SCOPE(ACTOR_PROFILE_QUERIES);
+
 	if (!ActorValid(pActor)) {
 		return nullptr;
 	}
 
-	for (u32 i = 0; i < actors.Count(); i++)
+	for (Actor& other : actors)
 	{
-		ActorHandle handle = actors.GetHandle(i);
-		Actor* pOther = actors.Get(handle);
+		Actor* pOther = &other;
 
-		if (!ActorValid(pOther)) {
+		if (!ActorValid(pOther) || pOther->flags.sleeping) {
 			continue;
 		}
 
@@ -214,10 +382,9 @@ Actor* Game::GetFirstActorCollision(const Actor* pActor, ActorFilterFn filter) {
 	return nullptr;
 }
 void Game::ForEachActor(TActorType type, ActorCallbackFn callback) {
-	for (u32 i = 0; i < actors.Count(); i++)
+	for (Actor& actor : actors)
 	{
-		ActorHandle handle = actors.GetHandle(i);
-		Actor* pActor = actors.Get(handle);
+		Actor* pActor = &actor;
 
 		if (!ActorValid(pActor)) {
 			continue;
@@ -231,10 +398,9 @@ void Game::ForEachActor(TActorType type, ActorCallbackFn callback) {
 	}
 }
 void Game::ForEachActor(ActorFilterFn filter, ActorCallbackFn callback) {
-	for (u32 i = 0; i < actors.Count(); i++)
+	for (Actor& actor : actors)
 	{
-		ActorHandle handle = actors.GetHandle(i);
-		Actor* pActor = actors.Get(handle);
+		Actor* pActor = &actor;
 
 		if (!ActorValid(pActor)) {
 			continue;
@@ -248,10 +414,9 @@ void Game::ForEachActor(ActorFilterFn filter, ActorCallbackFn callback) {
 	}
 }
 Actor* Game::GetFirstActor(TActorType type) {
-	for (u32 i = 0; i < actors.Count(); i++)
+	for (Actor& actor : actors)
 	{
-		ActorHandle handle = actors.GetHandle(i);
-		Actor* pActor = actors.Get(handle);
+		Actor* pActor = &actor;
 
 		if (!ActorValid(pActor)) {
 			continue;
@@ -267,10 +432,9 @@ Actor* Game::GetFirstActor(TActorType type) {
 	return nullptr;
 }
 Actor* Game::GetFirstActor(ActorFilterFn filter) {
-	for (u32 i = 0; i < actors.Count(); i++)
+	for (Actor& actor : actors)
 	{
-		ActorHandle handle = actors.GetHandle(i);
-		Actor* pActor = actors.Get(handle);
+		Actor* pActor = &actor;
 
 		if (!ActorValid(pActor)) {
 			continue;
@@ -369,6 +533,8 @@ void Game::ActorFacePlayer(Actor* pActor) {
 }
 
 bool Game::ActorMoveHorizontal(Actor* pActor, HitResult& outHit) {
+	ACTOR_PROFILE_SCOPE(ACTOR_PROFILE_TILE_SWEEPS);
+
 	const AABB& hitbox = pActor->hitbox;
 
 	const r32 dx = pActor->velocity.x;
@@ -379,6 +545,8 @@ bool Game::ActorMoveHorizontal(Actor* pActor, HitResult& outHit) {
 }
 
 bool Game::ActorMoveVertical(Actor* pActor, HitResult& outHit) {
+	ACTOR_PROFILE_SCOPE(ACTOR_PROFILE_TILE_SWEEPS);
+
 	const AABB& hitbox = pActor->hitbox;
 
 	const r32 dy = pActor->velocity.y;
@@ -422,10 +590,8 @@ static void SpawnDamageNumber(Actor* pActor, const Damage& damage) {
 	spawnPos += randomPointInsideHitbox;
 
 	constexpr glm::vec2 velocity = { 0, -0.03125f };
-	Actor* pDmg = Game::SpawnActor(dmgNumberPrototypeId, spawnPos, velocity);
-	if (pDmg != nullptr) {
-		pDmg->data.dmgNumber.damage = damage;
-	}
+	const s32 particleIndex = Game::SpawnParticle(dmgNumberPrototypeId, spawnPos, velocity);
+	Game::SetParticleDamage(particleIndex, damage);
 }
 
 // Returns new health after taking damage
@@ -462,34 +628,226 @@ u16 Game::ActorHeal(Actor* pActor, u16 value, u16 currentHealth, u16 maxHealth)
 
 #pragma endregion
 
-DynamicActorPool* Game::GetActors() {
-	return &actors;
+#pragma region Activation
+static void UpdateActorActivation() {
+	const glm::vec2 viewportPos = Game::Rendering::GetViewportPos();
+	const glm::vec2 min = viewportPos - activationMargin;
+	const glm::vec2 max = viewportPos + glm::vec2(VIEWPORT_WIDTH_METATILES, VIEWPORT_HEIGHT_METATILES) + activationMargin;
+
+	for (Actor& actor : actors) {
+		Actor* pActor = &actor;
+		if (pActor->flags.alwaysActive) {
+			continue;
+		}
+
+		const glm::vec2& pos = pActor->position;
+		pActor->flags.sleeping = pos.x < min.x || pos.x >= max.x || pos.y < min.y || pos.y >= max.y;
+	}
 }
+#pragma endregion
 
-void Game::UpdateActors() {
-	for (u32 i = 0; i < actors.Count(); i++)
-	{
+#pragma region Dispatch
+static u32 GetActorGroup(const Actor* pActor) {
+	return actorGroupOffsets[pActor->type] + pActor->subtype;
+}
+
+// Stable counting sort of unsortedActors into sortedActors, so pool order is kept within each group
+static void SortActorsByGroup(u32 count) {
+	memset(actorGroupStart, 0, sizeof(actorGroupStart));
+	for (u32 i = 0; i < count; i++) {
+		actorGroupStart[GetActorGroup(unsortedActors[i]) + 1]++;
+	}
+
+	for (u32 g = 0; g < ACTOR_GROUP_COUNT; g++) {
+		actorGroupStart[g + 1] += actorGroupStart[g];
+	}
+
+	u32 cursors[ACTOR_GROUP_COUNT];
+	memcpy(cursors, actorGroupStart, sizeof(cursors));
+	for (u32 i = 0; i < count; i++) {
+		Actor* pActor = unsortedActors[i];
+		sortedActors[cursors[GetActorGroup(pActor)]++] = pActor;
+	}
+}
+
+static bool DeferToParallelUpdate(Actor* pActor) {
+	if (!parallelUpdateEnabled || !actorParallelSafeTable[pActor->type][pActor->subtype]) {
+		return false;
+	}
+
+	parallelActors[parallelActorCount++] = pActor;
+	return true;
+}
+
+static void UpdateActorAtIndex(u32 index) {
+	PoolHandle<Actor> handle = actors.GetHandle(index);
+	Actor* pActor = &actors.GetDense(index);
+
+	if (pActor->flags.pendingRemoval) {
+		actorRemoveList.Add(handle);
+		return;
+	}
+
+	if (!pActor->flags.active || pActor->flags.sleeping) {
+		return;
+	}
+
+	if (DeferToParallelUpdate(pActor)) {
+		return;
+	}
+
+	Game::actorUpdateTable[pActor->type][pActor->subtype](pActor);
+}
+
+static void UpdateActorsBatched() {
+	// Actors spawned during the batches are updated afterwards in pool order, same as the default mode
+	const u32 snapshotCount = actors.Count();
+
+	u32 liveCount = 0;
+	for (u32 i = 0; i < snapshotCount; i++) {
 		PoolHandle<Actor> handle = actors.GetHandle(i);
-		Actor* pActor = actors.Get(handle);
+		Actor* pActor = &actors.GetDense(i);
 
-		if (pActor == nullptr) {
+		if (pActor->flags.pendingRemoval) {
+			actorRemoveList.Add(handle);
 			continue;
 		}
 
-		if (pActor->flags.pendingRemoval) {
-			actorRemoveList.Add(handle);
+		if (!pActor->flags.active || pActor->flags.sleeping) {
+			continue;
+		}
+
+		if (DeferToParallelUpdate(pActor)) {
+			continue;
+		}
+
+		unsortedActors[liveCount++] = pActor;
+	}
+
+	SortActorsByGroup(liveCount);
+
+	for (u32 g = 0; g < ACTOR_GROUP_COUNT; g++) {
+		const u32 begin = actorGroupStart[g];
+		const u32 end = actorGroupStart[g + 1];
+		if (begin == end) {
+			continue;
+		}
+
+		Actor** ppBatch = &sortedActors[begin];
+		const TActorType type = ppBatch[0]->type;
+		const TActorSubtype subtype = ppBatch[0]->subtype;
+
+		const ActorBatchUpdateFn* batchTable = Game::actorBatchUpdateTable[type];
+		if (batchTable && batchTable[subtype]) {
+			batchTable[subtype](ppBatch, end - begin);
 			continue;
 		}
 
-		if (!pActor->flags.active) {
+		const ActorUpdateFn updateFn = Game::actorUpdateTable[type][subtype];
+		for (u32 i = 0; i < end - begin; i++) {
+			// Flagged by an earlier update this frame, removed next frame like in pool order
+			if (ppBatch[i]->flags.pendingRemoval) {
+				continue;
+			}
+
+			updateFn(ppBatch[i]);
+		}
+	}
+
+	for (u32 i = snapshotCount; i < actors.Count(); i++) {
+		UpdateActorAtIndex(i);
+	}
+}
+
+static void DrawActorsBatched() {
+	u32 liveCount = 0;
+	for (Actor& actor : actors) {
+		Actor* pActor = &actor;
+		if (!Game::ActorValid(pActor)) {
 			continue;
 		}
 
-		actorUpdateTable[pActor->type][pActor->subtype](pActor);
+		unsortedActors[liveCount++] = pActor;
 	}
 
-	for (u32 i = 0; i < actorRemoveList.Count(); i++) {
-		auto handle = *actorRemoveList.Get(actorRemoveList.GetHandle(i));
+	SortActorsByGroup(liveCount);
+
+	for (u32 g = 0; g < ACTOR_GROUP_COUNT; g++) {
+		const u32 begin = actorGroupStart[g];
+		const u32 end = actorGroupStart[g + 1];
+		if (begin == end) {
+			continue;
+		}
+
+		const Actor* pFirst = sortedActors[begin];
+		const ActorDrawFn drawFn = Game::actorDrawTable[pFirst->type][pFirst->subtype];
+		for (u32 i = begin; i < end; i++) {
+			drawFn(sortedActors[i]);
+		}
+	}
+}
+#pragma endregion
+
+DynamicActorPool* Game::GetActors() {
+	return &actors;
+}
+
+glm::vec2 Game::GetActorActivationMargin() {
+	return activationMargin;
+}
+
+void Game::SetActorActivationMargin(const glm::vec2& margin) {
+	activationMargin = glm::max(margin, glm::vec2(0.0f));
+}
+
+void Game::SetActorProfilingEnabled(bool enabled) {
+	profilingEnabled = enabled;
+	memset(profileDepth, 0, sizeof(profileDepth));
+}
+
+const ActorProfileTimes& Game::GetActorProfileTimes() {
+	return profileTimes;
+}
+
+void Game::ResetActorProfileTimes() {
+	profileTimes = ActorProfileTimes{};
+}
+
+ActorDispatchMode Game::GetActorDispatchMode() {
+	return dispatchMode;
+}
+
+void Game::SetActorDispatchMode(ActorDispatchMode mode) {
+	dispatchMode = mode;
+}
+
+bool Game::GetActorParallelUpdateEnabled() {
+	return parallelUpdateEnabled;
+}
+
+void Game::SetActorParallelUpdateEnabled(bool enabled) {
+	parallelUpdateEnabled = enabled;
+}
+
+void Game::UpdateActors() {
+	ACTOR_PROFILE_SCOPE(ACTOR_PROFILE_UPDATE);
+
+	UpdateActorActivation();
+
+	parallelActorCount = 0;
+	if (dispatchMode == ACTOR_DISPATCH_BATCHED) {
+		UpdateActorsBatched();
+	}
+	else {
+		for (u32 i = 0; i < actors.Count(); i++) {
+			UpdateActorAtIndex(i);
+		}
+	}
+
+	// Pure subtypes run after everything else, so they see the final positions of the serially updated actors
+	UpdateActorsParallel(parallelActors, parallelActorCount);
+
+	for (const ActorHandle& handle : actorRemoveList) {
 		actors.Remove(handle);
 	}
 
@@ -504,13 +862,6 @@ bool Game::DrawActorDefault(const Actor* pActor) {
 		return false;
 	}
 
-	const ActorPrototype* pPrototype = AssetManager::GetAsset(pActor->__temp_actorPrototypeHandle);
-	if (!pPrototype) {	
-		return false;
-	}
-
-	const u16 animIndex = drawState.animIndex % pPrototype->animCount;
-
 	const Animation* pCurrentAnim = GetActorCurrentAnim(pActor);
 	if (!pCurrentAnim) {
 		return false;
@@ -525,9 +876,16 @@ bool Game::DrawActorDefault(const Actor* pActor) {
 }
 
 void Game::DrawActors() {
-	for (u32 i = 0; i < actors.Count(); i++)
+	ACTOR_PROFILE_SCOPE(ACTOR_PROFILE_SPRITES);
+
+	// NOTE: Batched mode changes sprite submission order within a layer
+	if (dispatchMode == ACTOR_DISPATCH_BATCHED) {
+		return DrawActorsBatched();
+	}
+
+	for (Actor& actor : actors)
 	{
-		Actor* pActor = actors.Get(actors.GetHandle(i));
+		Actor* pActor = &actor;
 		if (!ActorValid(pActor)) {
 			continue;
 		}
@@ -535,4 +893,3 @@ void Game::DrawActors() {
 		actorDrawTable[pActor->type][pActor->subtype](pActor);
 	}
 }
-
@@ -15,6 +15,8 @@ struct ActorFlags {
 	bool inAir : 1;
 	bool active : 1;
 	bool pendingRemoval : 1;
+	bool alwaysActive : 1;
+	bool sleeping : 1; // Outside the activation region, skips update and collision queries
 };
 
 struct ActorDrawState {
@@ -30,6 +32,12 @@ struct ActorDrawState {
 	bool vFlip : 1 = false;
 	bool visible : 1 = true;
 	bool useCustomPalette : 1 = false;
+
+	// Resolved asset pointers, refreshed when animIndex or the asset generation changes
+	mutable const ActorPrototype* pPrototype = nullptr;
+	mutable const Animation* pCurrentAnim = nullptr;
+	mutable u32 assetGeneration = 0;
+	mutable u16 resolvedAnimIndex = 0;
 };
 
 struct Actor {
@@ -68,6 +76,28 @@ typedef bool (*ActorFilterFn)(const Actor*);
 typedef void (*ActorInitFn)(Actor*, const PersistedActorData*);
 typedef void (*ActorUpdateFn)(Actor*);
 typedef bool (*ActorDrawFn)(const Actor*);
+// Updates a contiguous batch of actors of the same type and subtype
+// NOTE: Actors can be flagged for removal by earlier actors in the same batch, so check pendingRemoval
+typedef void (*ActorBatchUpdateFn)(Actor** ppActors, u32 count);
+
+enum ActorProfileCategory : u8 {
+	ACTOR_PROFILE_UPDATE, // Includes queries and tile sweeps
+	ACTOR_PROFILE_QUERIES, // Actor vs actor collision queries
+	ACTOR_PROFILE_TILE_SWEEPS,
+	ACTOR_PROFILE_SPRITES,
+
+	ACTOR_PROFILE_CATEGORY_COUNT
+};
+
+struct ActorProfileTimes {
+	r64 seconds[ACTOR_PROFILE_CATEGORY_COUNT];
+	u32 calls[ACTOR_PROFILE_CATEGORY_COUNT];
+};
+
+enum ActorDispatchMode : u8 {
+	ACTOR_DISPATCH_POOL_ORDER,
+	ACTOR_DISPATCH_BATCHED, // Group actors by type and subtype before dispatching
+};
 
 enum PlayerWeaponType : u8 {
 	PLAYER_WEAPON_BOW,
@@ -90,6 +120,7 @@ namespace Game {
 	Actor* SpawnActor(const ActorPrototypeHandle& prototypeHandle, const glm::vec2& position, const glm::vec2& velocity = {0.0f, 0.0f});
 	void ClearActors();
 
+	const ActorPrototype* GetActorPrototype(const Actor* pActor);
 	const Animation* GetActorCurrentAnim(const Actor* pActor);
 	bool ActorValid(const Actor* pActor);
 	bool ActorsColliding(const Actor* pActor, const Actor* pOther);
@@ -125,10 +156,36 @@ namespace Game {
 	u16 ActorHeal(Actor* pActor, u16 value, u16 currentHealth, u16 maxHealth);
 
 	DynamicActorPool* GetActors(); // TEMP
+	glm::vec2 GetActorActivationMargin();
+	void SetActorActivationMargin(const glm::vec2& margin);
+	// Profiling adds a timer read around each query and sweep, so it's off by default
+	void SetActorProfilingEnabled(bool enabled);
+	const ActorProfileTimes& GetActorProfileTimes();
+	void ResetActorProfileTimes();
+
+	ActorDispatchMode GetActorDispatchMode();
+	void SetActorDispatchMode(ActorDispatchMode mode);
+	// Updates pure subtypes on worker threads, see actor_commands.h
+	bool GetActorParallelUpdateEnabled();
+	void SetActorParallelUpdateEnabled(bool enabled);
 	void UpdateActors();
 	bool DrawActorDefault(const Actor* pActor);
 	void DrawActors();
 
+	// Batch update for subtypes that only need their update called in a tight loop.
+	// The update function is a template argument so it can be inlined into the loop
+	template <ActorUpdateFn updateFn>
+	void UpdateActorBatch(Actor** ppActors, u32 count) {
+		for (u32 i = 0; i < count; i++) {
+			Actor* pActor = ppActors[i];
+			if (pActor->flags.pendingRemoval) {
+				continue;
+			}
+
+			updateFn(pActor);
+		}
+	}
+
 	extern const ActorInitFn playerInitTable[PLAYER_TYPE_COUNT];
 	extern const ActorUpdateFn playerUpdateTable[PLAYER_TYPE_COUNT];
 	extern const ActorDrawFn playerDrawTable[PLAYER_TYPE_COUNT];
@@ -140,6 +197,7 @@ namespace Game {
 	extern const ActorInitFn bulletInitTable[BULLET_TYPE_COUNT];
 	extern const ActorUpdateFn bulletUpdateTable[BULLET_TYPE_COUNT];
 	extern const ActorDrawFn bulletDrawTable[BULLET_TYPE_COUNT];
+	extern const ActorBatchUpdateFn bulletBatchUpdateTable[BULLET_TYPE_COUNT];
 
 	extern const ActorInitFn pickupInitTable[PICKUP_TYPE_COUNT];
 	extern const ActorUpdateFn pickupUpdateTable[PICKUP_TYPE_COUNT];
@@ -148,6 +206,7 @@ namespace Game {
 	extern const ActorInitFn effectInitTable[EFFECT_TYPE_COUNT];
 	extern const ActorUpdateFn effectUpdateTable[EFFECT_TYPE_COUNT];
 	extern const ActorDrawFn effectDrawTable[EFFECT_TYPE_COUNT];
+	extern const ActorBatchUpdateFn effectBatchUpdateTable[EFFECT_TYPE_COUNT];
 
 	extern const ActorInitFn interactableInitTable[INTERACTABLE_TYPE_COUNT];
 	extern const ActorUpdateFn interactableUpdateTable[INTERACTABLE_TYPE_COUNT];
@@ -177,6 +236,17 @@ namespace Game {
 		spawnerUpdateTable,
 	};
 
+	// Optional, nullptr entries fall back to calling actorUpdateTable per actor
+	constexpr ActorBatchUpdateFn const* actorBatchUpdateTable[ACTOR_TYPE_COUNT] = {
+		nullptr,
+		nullptr,
+		bulletBatchUpdateTable,
+		nullptr,
+		effectBatchUpdateTable,
+		nullptr,
+		nullptr,
+	};
+
 	constexpr ActorDrawFn const* actorDrawTable[ACTOR_TYPE_COUNT] = {
 		playerDrawTable,
 		enemyDrawTable,
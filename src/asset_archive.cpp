@@ -1,18 +1,238 @@
+#ifdef PLATFORM_WINDOWS
+	#include <windows.h>
+#elif PLATFORM_LINUX
+	#include <sys/mman.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
 #include "asset_archive.h"
+#include "compression.h"
 #include <cstdio>
 #include <cstring>
 #include <cstdlib>
+#include <bit>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #ifdef ASSET_ARCHIVE_USE_ARENA
 #include "memory_arena.h"
 #endif
 
+// The index arena only reserves address space where virtual memory is available
+static constexpr size_t INDEX_ARENA_RESERVE_SIZE = 1024ull * 1024 * 1024; // 1 GB
+static constexpr size_t INDEX_ARENA_FALLBACK_SIZE = 64 * 1024 * 1024; // 64 MB
+
+// The archive is written straight from memory
+static_assert(std::endian::native == std::endian::little, "NPAK archives are little-endian");
+
+constexpr char ARCHIVE_SIGNATURE[4] = { 'N','P','A','K' };
+constexpr u8 ARCHIVE_ENTRY_COMPRESSED = 1 << 0;
+
+// Decompressed data only lives in the cache, so only types that are looked up again on every use can be compressed.
+// Pointers to the rest are kept around by the game. Sounds are read by the audio callback while the main thread
+// can evict them, so they stay uncompressed
+static constexpr bool COMPRESSIBLE_ASSET_TYPES[ASSET_TYPE_COUNT] = {
+	true, // CHR_BANK
+	false, // SOUND
+	false, // TILESET
+	false, // METASPRITE
+	false, // ACTOR_PROTOTYPE
+	true, // ROOM_TEMPLATE
+	false, // DUNGEON
+	false, // OVERWORLD
+	false, // ANIMATION
+	false, // PALETTE
+	false, // SHADER
+};
+// Granularity for touching mapped pages
+static constexpr size_t PREFETCH_PAGE_SIZE = 4096;
+// Compressed payloads have to save at least this fraction of the size to be worth decompressing
+static constexpr size_t MIN_COMPRESSION_SAVING_DIVISOR = 8;
+
+#pragma region XXH64
+constexpr u64 XXH_PRIME64_1 = 0x9E3779B185EBCA87ULL;
+constexpr u64 XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr u64 XXH_PRIME64_3 = 0x165667B19E3779F9ULL;
+constexpr u64 XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr u64 XXH_PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline u64 XXHRead64(const u8* p) {
+	u64 result;
+	memcpy(&result, p, sizeof(u64));
+	return result;
+}
+
+static inline u32 XXHRead32(const u8* p) {
+	u32 result;
+	memcpy(&result, p, sizeof(u32));
+	return result;
+}
+
+static inline u64 XXHRound(u64 acc, u64 input) {
+	acc += input * XXH_PRIME64_2;
+	acc = std::rotl(acc, 31);
+	return acc * XXH_PRIME64_1;
+}
+
+static inline u64 XXHMergeRound(u64 acc, u64 value) {
+	acc ^= XXHRound(0, value);
+	return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+static u64 XXHash64(const void* pData, size_t length, u64 seed = 0) {
+	const u8* p = (const u8*)pData;
+	const u8* const pEnd = p + length;
+	u64 hash;
+
+	if (length >= 32) {
+		u64 v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+		u64 v2 = seed + XXH_PRIME64_2;
+		u64 v3 = seed;
+		u64 v4 = seed - XXH_PRIME64_1;
+
+		const u8* const pLimit = pEnd - 32;
+		do {
+			v1 = XXHRound(v1, XXHRead64(p));
+			v2 = XXHRound(v2, XXHRead64(p + 8));
+			v3 = XXHRound(v3, XXHRead64(p + 16));
+			v4 = XXHRound(v4, XXHRead64(p + 24));
+			p += 32;
+		} while (p <= pLimit);
+
+		hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+		hash = XXHMergeRound(hash, v1);
+		hash = XXHMergeRound(hash, v2);
+		hash = XXHMergeRound(hash, v3);
+		hash = XXHMergeRound(hash, v4);
+	}
+	else {
+		hash = seed + XXH_PRIME64_5;
+	}
+
+	hash += length;
+
+	while (p + 8 <= pEnd) {
+		hash ^= XXHRound(0, XXHRead64(p));
+		hash = std::rotl(hash, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+		p += 8;
+	}
+
+	if (p + 4 <= pEnd) {
+		hash ^= (u64)XXHRead32(p) * XXH_PRIME64_1;
+		hash = std::rotl(hash, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+		p += 4;
+	}
+
+	while (p < pEnd) {
+		hash ^= (*p) * XXH_PRIME64_5;
+		hash = std::rotl(hash, 11) * XXH_PRIME64_1;
+		p++;
+	}
+
+	hash ^= hash >> 33;
+	hash *= XXH_PRIME64_2;
+	hash ^= hash >> 29;
+	hash *= XXH_PRIME64_3;
+	hash ^= hash >> 32;
+	return hash;
+}
+#pragma endregion
+
+static constexpr size_t AlignUp(size_t value, size_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static constexpr size_t GetAssetAlignment(size_t size) {
+	return size >= ASSET_DATA_LARGE_ALIGNMENT ? ASSET_DATA_LARGE_ALIGNMENT : ASSET_DATA_ALIGNMENT;
+}
+
+static inline char NormalizePathChar(char c) {
+	return c == '\\' ? '/' : c;
+}
+
+// FNV-1a over the path with unified separators
+static u64 HashAssetPath(const char* path) {
+	u64 hash = 0xCBF29CE484222325ULL;
+	for (const char* p = path; *p; p++) {
+		hash ^= (u8)NormalizePathChar(*p);
+		hash *= 0x100000001B3ULL;
+	}
+
+	// Zero is reserved as the empty key
+	return hash != 0 ? hash : 1;
+}
+
+static bool AssetPathsEqual(const char* a, const char* b) {
+	while (*a && NormalizePathChar(*a) == NormalizePathChar(*b)) {
+		a++;
+		b++;
+	}
+	return *a == *b;
+}
+
+static inline size_t GetStoredSize(const AssetEntry& entry) {
+	return entry.flags.compressed ? entry.compressedSize : entry.size;
+}
+
 static bool CompareAssetEntries(const AssetEntry& a, const AssetEntry& b) {
 	return a.id < b.id;
 }
 
+static u64 GetAssetEntryKey(const AssetEntry& entry) {
+	return entry.id;
+}
+
 AssetArchive::AssetArchive() 
-	: m_capacity(0), m_size(0), m_data(nullptr) {
+	: m_capacity(0), m_size(0), m_data(nullptr), m_generation(1), m_bulkAdd(false), m_pIndexMemory(nullptr),
+	  m_pathCollisionCount(0), m_typeIds{}, m_dependencyIds{}, m_pBundles(nullptr), m_bundleCount(0), m_bundleCapacity(0), m_pMapping(nullptr), m_mappingSize(0), m_pMappedEntries(nullptr), m_mappedEntryCount(0), m_pMappedVerified(nullptr),
+	  m_pArenaBase(nullptr), m_pCache(nullptr), m_cacheEntryCount(0), m_cacheClock(0), m_cacheFrame(1) {
+}
+
+AssetArchive::~AssetArchive() {
+	Clear();
+
+	if (m_pIndexMemory) {
+		if (m_indexArena.IsVirtual()) {
+			ArenaAllocator::ReleaseVirtualMemory(m_pIndexMemory, m_indexArena.Capacity());
+		}
+		else free(m_pIndexMemory);
+	}
+}
+
+// The index arena is set up on first use, so archives that are never filled don't reserve anything
+bool AssetArchive::InitIndex() {
+	if (m_pIndexMemory) {
+		return true;
+	}
+
+	m_pIndexMemory = ArenaAllocator::ReserveVirtualMemory(INDEX_ARENA_RESERVE_SIZE, false);
+	if (m_pIndexMemory) {
+		m_indexArena.InitVirtual(m_pIndexMemory, INDEX_ARENA_RESERVE_SIZE, "Asset index", false);
+	}
+	else {
+		m_pIndexMemory = malloc(INDEX_ARENA_FALLBACK_SIZE);
+		if (!m_pIndexMemory) {
+			return false;
+		}
+		m_indexArena.Init(m_pIndexMemory, INDEX_ARENA_FALLBACK_SIZE, "Asset index");
+	}
+
+	ResetIndex(ASSET_INDEX_INITIAL_CAPACITY);
+	return true;
+}
+
+void AssetArchive::ResetIndex(u32 capacity) {
+	m_indexArena.Clear();
+	m_index.Init(&m_indexArena, capacity);
+	m_pathIndex.Init(&m_indexArena, capacity);
+	m_pathCollisionCount = 0;
+	memset(m_typeIds, 0, sizeof(m_typeIds));
+	m_dependencyIds = {};
+	m_pBundles = nullptr;
+	m_bundleCount = 0;
+	m_bundleCapacity = 0;
 }
 
 constexpr size_t AssetArchive::GetNextPOT(size_t n) {
@@ -34,7 +254,12 @@ bool AssetArchive::ResizeStorage(size_t minCapacity) {
 #ifdef ASSET_ARCHIVE_USE_ARENA
 	// Resize in place
 	size_t bytesToPush = newCapacity - m_capacity;
-	void* result = ArenaAllocator::Push(ARENA_ASSETS, bytesToPush);
+	// Align the base for the payloads, growing must stay contiguous
+	const size_t alignment = m_data == nullptr ? ASSET_DATA_LARGE_ALIGNMENT : 1;
+	if (!m_pArenaBase) {
+		m_pArenaBase = ArenaAllocator::GetMarker(ARENA_ASSETS).position;
+	}
+	void* result = ArenaAllocator::Push(ARENA_ASSETS, bytesToPush, alignment);
 	if (!result) {
 		return false;
 	}
@@ -69,6 +294,99 @@ bool AssetArchive::CreateEmpty() {
 	return true;
 }
 
+bool AssetArchive::ValidateHeader(const ArchiveHeader& header, size_t fileSize) {
+	if (memcmp(header.signature, ARCHIVE_SIGNATURE, 4) != 0 || header.version != ASSET_ARCHIVE_VERSION) {
+		return false;
+	}
+
+	if (header.entryTableOffset < sizeof(ArchiveHeader) ||
+		header.entryTableOffset + header.assetCount * sizeof(ArchiveEntry) > header.bundleTableOffset ||
+		header.bundleTableOffset + header.bundleCount * sizeof(ArchiveBundle) > header.dependencyTableOffset ||
+		header.dependencyCount > UINT32_MAX ||
+		header.dependencyTableOffset % alignof(u64) != 0 ||
+		header.dependencyTableOffset + header.dependencyCount * sizeof(u64) > header.stringTableOffset ||
+		header.stringTableOffset + header.stringTableSize > header.dataOffset ||
+		header.dataOffset % ASSET_DATA_LARGE_ALIGNMENT != 0 ||
+		header.dataOffset + header.dataSize > fileSize) {
+		return false;
+	}
+
+	return true;
+}
+
+bool AssetArchive::ReadIndex(const ArchiveEntry* pEntries, const ArchiveBundle* pBundles, const u64* pDependencies, const char* pStrings, const ArchiveHeader& header, bool& outSorted) {
+	if (!InitIndex() || !m_index.Reserve(header.assetCount) || !m_pathIndex.Reserve(header.assetCount)) {
+		return false;
+	}
+
+	// Copied, so the table stays valid when a mapping is replaced by owned storage
+	const u32 dependencyCount = (u32)header.dependencyCount;
+	if (!ReserveIds(m_dependencyIds, dependencyCount)) {
+		return false;
+	}
+	if (dependencyCount > 0) {
+		memcpy(m_dependencyIds.pIds, pDependencies, dependencyCount * sizeof(u64));
+	}
+	m_dependencyIds.count = dependencyCount;
+
+	for (u32 i = 0; i < header.bundleCount; i++) {
+		const ArchiveBundle& bundle = pBundles[i];
+		if ((u64)bundle.firstAsset + bundle.assetCount > dependencyCount || !AddBundle(bundle.id, bundle.firstAsset, bundle.assetCount)) {
+			return false;
+		}
+	}
+
+	bool sorted = true;
+	for (u32 i = 0; i < header.assetCount; i++) {
+		const ArchiveEntry& archiveEntry = pEntries[i];
+		const bool compressed = archiveEntry.flags & ARCHIVE_ENTRY_COMPRESSED;
+		const u64 storedSize = compressed ? archiveEntry.compressedSize : archiveEntry.size;
+		if (archiveEntry.offset + storedSize > header.dataSize ||
+			(compressed && archiveEntry.size > ASSET_CACHE_SIZE) ||
+			archiveEntry.pathOffset + archiveEntry.pathLength >= header.stringTableSize ||
+			archiveEntry.pathLength >= MAX_ASSET_PATH_LENGTH ||
+			(u64)archiveEntry.firstDependency + archiveEntry.dependencyCount > dependencyCount) {
+			return false;
+		}
+
+		if (i > 0 && pEntries[i - 1].id >= archiveEntry.id) {
+			sorted = false;
+		}
+
+		PoolHandle<AssetEntry> handle = m_index.Add();
+		if (handle == PoolHandle<AssetEntry>::Null()) {
+			return false;
+		}
+		AssetEntry* entry = m_index.Get(handle);
+		entry->id = archiveEntry.id;
+		memcpy(entry->relativePath, pStrings + archiveEntry.pathOffset, archiveEntry.pathLength);
+		entry->relativePath[archiveEntry.pathLength] = '\0';
+		entry->offset = archiveEntry.offset;
+		entry->size = archiveEntry.size;
+		entry->compressedSize = compressed ? archiveEntry.compressedSize : 0;
+		entry->firstDependency = archiveEntry.firstDependency;
+		entry->dependencyCount = archiveEntry.dependencyCount;
+		entry->flags.type = (AssetType)archiveEntry.type;
+		entry->flags.deleted = false;
+		entry->flags.compressed = compressed;
+
+		if (compressed && !InitCache()) {
+			return false;
+		}
+	}
+
+	if (!sorted) {
+		m_index.SortByKey(GetAssetEntryKey);
+	}
+
+	for (const AssetEntry& entry : m_index) {
+		AddToLookups(entry);
+	}
+
+	outSorted = sorted;
+	return true;
+}
+
 bool AssetArchive::LoadFromFile(const std::filesystem::path& path) {
 	if (!std::filesystem::exists(path)) {
 		return CreateEmpty();
@@ -77,70 +395,384 @@ bool AssetArchive::LoadFromFile(const std::filesystem::path& path) {
 	// Clear existing data
 	Clear();
 
+	std::error_code error;
+	const size_t fileSize = std::filesystem::file_size(path, error);
+	if (error) {
+		return false;
+	}
+
 	FILE* pFile = fopen(path.string().c_str(), "rb");
 	if (!pFile) {
 		return false;
 	}
 
 	ArchiveHeader header;
-	fread(&header, sizeof(ArchiveHeader), 1, pFile);
-
-	constexpr char validSignature[4] = {'N','P','A','K'};
-	if (memcmp(header.signature, validSignature, 4) != 0) {
+	if (fread(&header, sizeof(ArchiveHeader), 1, pFile) != 1 || !ValidateHeader(header, fileSize)) {
 		fclose(pFile);
 		return false;
 	}
 
-	const size_t size = header.directoryOffset - sizeof(ArchiveHeader);
-	if (!ResizeStorage(size)) {
-		fclose(pFile);
+	// Entry and string tables only need to live until the index is built
+	const size_t directorySize = header.dataOffset - header.entryTableOffset;
+#ifdef ASSET_ARCHIVE_USE_ARENA
+	ArenaMarker tempMarker = ArenaAllocator::GetMarker(ARENA_SCRATCH);
+	u8* pDirectory = (u8*)ArenaAllocator::Push(ARENA_SCRATCH, directorySize);
+#else
+	u8* pDirectory = (u8*)malloc(directorySize);
+#endif
+
+	bool result = pDirectory != nullptr;
+	if (result) {
+		fseek(pFile, (long)header.entryTableOffset, SEEK_SET);
+		result = fread(pDirectory, 1, directorySize, pFile) == directorySize;
+	}
+
+	const ArchiveEntry* pEntries = (const ArchiveEntry*)pDirectory;
+	if (result) {
+		// Read before the data, so the cache is allocated below the storage and doesn't get in the way of growing it
+		const ArchiveBundle* pBundles = (const ArchiveBundle*)(pDirectory + (header.bundleTableOffset - header.entryTableOffset));
+		const u64* pDependencies = (const u64*)(pDirectory + (header.dependencyTableOffset - header.entryTableOffset));
+		const char* pStrings = (const char*)pDirectory + (header.stringTableOffset - header.entryTableOffset);
+		bool sorted;
+		result = ReadIndex(pEntries, pBundles, pDependencies, pStrings, header, sorted);
+	}
+
+	if (result) {
+		result = ResizeStorage(header.dataSize);
+	}
+
+	if (result) {
+		result = fread(m_data, 1, header.dataSize, pFile) == header.dataSize;
+		m_size = header.dataSize;
+	}
+
+	// The data has to be read anyway, so it's verified up front
+	for (u32 i = 0; result && i < header.assetCount; i++) {
+		const ArchiveEntry& entry = pEntries[i];
+		const size_t storedSize = (entry.flags & ARCHIVE_ENTRY_COMPRESSED) ? entry.compressedSize : entry.size;
+		result = XXHash64(m_data + entry.offset, storedSize) == entry.checksum;
+	}
+
+#ifdef ASSET_ARCHIVE_USE_ARENA
+	ArenaAllocator::PopToMarker(ARENA_SCRATCH, tempMarker);
+#else
+	free(pDirectory);
+#endif
+	fclose(pFile);
+
+	if (!result) {
+		Clear();
+	}
+	return result;
+}
+
+bool AssetArchive::MapFile(const std::filesystem::path& path) {
+#if defined(PLATFORM_WINDOWS) || defined(PLATFORM_LINUX)
+	if (!std::filesystem::exists(path)) {
+		return CreateEmpty();
+	}
+
+	Clear();
+
+	std::error_code error;
+	const size_t fileSize = std::filesystem::file_size(path, error);
+	if (error || fileSize < sizeof(ArchiveHeader)) {
 		return false;
 	}
-	
-	fread(m_data, 1, size, pFile);
-	m_size = size;
 
-	size_t assetCount = header.assetCount;
-	if (assetCount > MAX_ASSETS) {
-		fclose(pFile);
+#ifdef PLATFORM_WINDOWS
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
 		return false;
 	}
-	
-	for (size_t i = 0; i < assetCount; i++) {
-		PoolHandle<AssetEntry> handle = m_index.Add();
-		AssetEntry* entry = m_index.Get(handle);
-		fread(entry, sizeof(AssetEntry), 1, pFile);
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (!mapping) {
+		return false;
 	}
-	
-	m_index.Sort(CompareAssetEntries);
+	// Copy on write, so the game can still patch asset data in memory
+	void* pMapping = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!pMapping) {
+		return false;
+	}
+#else
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	// Private writable mapping, so the game can still patch asset data in memory without touching the file
+	void* pMapping = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (pMapping == MAP_FAILED) {
+		return false;
+	}
+#endif
 
-	fclose(pFile);
+	m_pMapping = pMapping;
+	m_mappingSize = fileSize;
+
+	// The mapping is page aligned, so the header, entry table and data section can be used in place
+	u8* pBytes = (u8*)pMapping;
+	const ArchiveHeader& header = *(const ArchiveHeader*)pBytes;
+	if (!ValidateHeader(header, fileSize)) {
+		Unmap();
+		return false;
+	}
+
+	const ArchiveEntry* pEntries = (const ArchiveEntry*)(pBytes + header.entryTableOffset);
+	bool sorted;
+	const ArchiveBundle* pBundles = (const ArchiveBundle*)(pBytes + header.bundleTableOffset);
+	const u64* pDependencies = (const u64*)(pBytes + header.dependencyTableOffset);
+	if (!ReadIndex(pEntries, pBundles, pDependencies, (const char*)pBytes + header.stringTableOffset, header, sorted)) {
+		Clear();
+		return false;
+	}
+
+	// Unsorted archives are served from the index, which has no checksums
+	if (sorted) {
+		m_pMappedVerified = (std::atomic<u8>*)m_indexArena.Push(sizeof(std::atomic<u8>) * (header.assetCount ? header.assetCount : 1), alignof(std::atomic<u8>), "Verified assets");
+		if (!m_pMappedVerified) {
+			Clear();
+			return false;
+		}
+		memset((void*)m_pMappedVerified, 0, sizeof(std::atomic<u8>) * header.assetCount);
+		m_pMappedEntries = pEntries;
+		m_mappedEntryCount = header.assetCount;
+	}
+
+	m_data = pBytes + header.dataOffset;
+	m_size = header.dataSize;
+	m_capacity = m_size;
+	MarkModified();
+	return true;
+#else
+	return LoadFromFile(path);
+#endif
+}
+
+const AssetArchive::ArchiveEntry* AssetArchive::FindArchiveEntry(u64 id) const {
+	u32 left = 0;
+	u32 right = m_mappedEntryCount;
+
+	while (left < right) {
+		u32 mid = left + (right - left) / 2;
+		const ArchiveEntry* entry = &m_pMappedEntries[mid];
+
+		if (entry->id == id) {
+			return entry;
+		} else if (entry->id < id) {
+			left = mid + 1;
+		} else {
+			right = mid;
+		}
+	}
+
+	return nullptr;
+}
+
+// Hashing reads the whole payload, so it's deferred until the payload is needed anyway
+bool AssetArchive::VerifyArchiveEntry(const ArchiveEntry* pEntry) {
+	std::atomic<u8>& verified = m_pMappedVerified[pEntry - m_pMappedEntries];
+	if (verified.load(std::memory_order_acquire)) {
+		return true;
+	}
+
+	const size_t storedSize = (pEntry->flags & ARCHIVE_ENTRY_COMPRESSED) ? pEntry->compressedSize : pEntry->size;
+	if (XXHash64(m_data + pEntry->offset, storedSize) != pEntry->checksum) {
+		return false;
+	}
+	verified.store(1, std::memory_order_release);
+	return true;
+}
+
+bool AssetArchive::IsMapped() const {
+	return m_pMapping != nullptr;
+}
+
+void AssetArchive::Unmap() {
+	if (!m_pMapping) {
+		return;
+	}
+
+#ifdef PLATFORM_WINDOWS
+	UnmapViewOfFile(m_pMapping);
+#elif PLATFORM_LINUX
+	munmap(m_pMapping, m_mappingSize);
+#endif
+	m_pMapping = nullptr;
+	m_mappingSize = 0;
+	m_pMappedEntries = nullptr;
+	m_mappedEntryCount = 0;
+	m_pMappedVerified = nullptr;
+}
+
+// Moves mapped asset data into owned storage before it gets modified
+bool AssetArchive::EnsureWritable() {
+	if (!IsMapped()) {
+		return true;
+	}
+
+	const u8* pMappedData = m_data;
+	const size_t size = m_size;
+	m_data = nullptr;
+	m_capacity = 0;
+	if (!ResizeStorage(size)) {
+		m_data = (u8*)pMappedData;
+		m_capacity = size;
+		return false;
+	}
+
+	memcpy(m_data, pMappedData, size);
+	Unmap();
+	MarkModified();
 	return true;
 }
 
-bool AssetArchive::SaveToFile(const std::filesystem::path& path) {
+bool AssetArchive::SaveToFile(const std::filesystem::path& path, bool compress) {
+	if (!Repack()) {
+		return false;
+	}
+
 	FILE* pFile = fopen(path.string().c_str(), "wb");
 	if (!pFile) {
 		return false;
 	}
 
-	Repack();
+	const u32 assetCount = m_index.Count();
+	std::vector<ArchiveEntry> entries(assetCount);
+	std::vector<char> strings;
+	std::unordered_map<std::string_view, u32> stringOffsets;
+	stringOffsets.reserve(assetCount);
+
+	// Newly compressed payloads, the rest are written straight from storage
+	std::vector<u8> compressedData;
+	std::vector<size_t> compressedOffsets(assetCount, SIZE_MAX);
+
+	for (u32 i = 0; i < assetCount; i++) {
+		const AssetEntry& asset = m_index.GetDense(i);
+		const std::string_view assetPath(asset.relativePath);
+
+		auto [it, inserted] = stringOffsets.try_emplace(assetPath, (u32)strings.size());
+		if (inserted) {
+			strings.insert(strings.end(), assetPath.begin(), assetPath.end());
+			strings.push_back('\0');
+		}
+
+		bool compressed = asset.flags.compressed;
+		size_t storedSize = GetStoredSize(asset);
+		const u8* pStored = m_data + asset.offset;
+
+		if (compress && !compressed && COMPRESSIBLE_ASSET_TYPES[asset.flags.type] && asset.size <= ASSET_CACHE_SIZE) {
+			const size_t start = compressedData.size();
+			compressedData.resize(start + Compression::GetMaxCompressedSize(asset.size));
+			const size_t size = Compression::Compress(pStored, asset.size, compressedData.data() + start, compressedData.size() - start);
+
+			if (size != 0 && size <= asset.size - asset.size / MIN_COMPRESSION_SAVING_DIVISOR) {
+				compressedData.resize(start + size);
+				compressedOffsets[i] = start;
+				compressed = true;
+				storedSize = size;
+				pStored = compressedData.data() + start;
+			}
+			else {
+				compressedData.resize(start);
+			}
+		}
+
+		entries[i] = {
+			.id = asset.id,
+			.offset = 0, // Assigned once the layout is known
+			.size = asset.size,
+			.compressedSize = compressed ? storedSize : 0,
+			.checksum = XXHash64(pStored, storedSize),
+			.pathOffset = it->second,
+			.pathLength = (u16)assetPath.size(),
+			.type = (u8)asset.flags.type,
+			.flags = (u8)(compressed ? ARCHIVE_ENTRY_COMPRESSED : 0),
+			.firstDependency = asset.firstDependency,
+			.dependencyCount = asset.dependencyCount,
+		};
+	}
+
+	// Bundles are laid out first so each one can be read sequentially, assets shared with an earlier bundle stay there
+	std::unordered_map<u64, u32> denseIndices;
+	denseIndices.reserve(assetCount);
+	for (u32 i = 0; i < assetCount; i++) {
+		denseIndices.emplace(entries[i].id, i);
+	}
+
+	std::vector<u32> order;
+	std::vector<bool> ordered(assetCount, false);
+	order.reserve(assetCount);
+	for (u32 b = 0; b < m_bundleCount; b++) {
+		const ArchiveBundle& bundle = m_pBundles[b];
+		for (u32 i = 0; i < bundle.assetCount; i++) {
+			const auto it = denseIndices.find(m_dependencyIds.pIds[bundle.firstAsset + i]);
+			if (it == denseIndices.end()) {
+				continue;
+			}
+
+			const u32 denseIndex = it->second;
+			if (!ordered[denseIndex]) {
+				ordered[denseIndex] = true;
+				order.push_back(denseIndex);
+			}
+		}
+	}
+	for (u32 i = 0; i < assetCount; i++) {
+		if (!ordered[i]) {
+			order.push_back(i);
+		}
+	}
+
+	u64 dataSize = 0;
+	for (u32 i : order) {
+		ArchiveEntry& entry = entries[i];
+		const size_t storedSize = (entry.flags & ARCHIVE_ENTRY_COMPRESSED) ? entry.compressedSize : entry.size;
+		entry.offset = AlignUp(dataSize, GetAssetAlignment(storedSize));
+		dataSize = entry.offset + storedSize;
+	}
+
+	// The string views point into the index, which is fine since it isn't modified while writing
+	const u64 entryTableOffset = sizeof(ArchiveHeader);
+	const u64 bundleTableOffset = entryTableOffset + assetCount * sizeof(ArchiveEntry);
+	const u64 dependencyTableOffset = bundleTableOffset + m_bundleCount * sizeof(ArchiveBundle);
+	const u64 stringTableOffset = dependencyTableOffset + m_dependencyIds.count * sizeof(u64);
+	const u64 dataOffset = AlignUp(stringTableOffset + strings.size(), ASSET_DATA_LARGE_ALIGNMENT);
 
 	ArchiveHeader header{
 		.signature = { 'N','P','A','K' },
-		.assetCount = static_cast<u32>(m_index.Count()),
-		.directoryOffset = sizeof(ArchiveHeader) + m_size,
+		.version = ASSET_ARCHIVE_VERSION,
+		.assetCount = assetCount,
+		.bundleCount = m_bundleCount,
+		.entryTableOffset = entryTableOffset,
+		.bundleTableOffset = bundleTableOffset,
+		.dependencyTableOffset = dependencyTableOffset,
+		.dependencyCount = m_dependencyIds.count,
+		.stringTableOffset = stringTableOffset,
+		.stringTableSize = strings.size(),
+		.dataOffset = dataOffset,
+		.dataSize = dataSize,
 	};
 	fwrite(&header, sizeof(ArchiveHeader), 1, pFile);
+	fwrite(entries.data(), sizeof(ArchiveEntry), assetCount, pFile);
+	fwrite(m_pBundles, sizeof(ArchiveBundle), m_bundleCount, pFile);
+	fwrite(m_dependencyIds.pIds, sizeof(u64), m_dependencyIds.count, pFile);
+	fwrite(strings.data(), 1, strings.size(), pFile);
 
-	fwrite(m_data, 1, m_size, pFile);
+	constexpr u8 padding[ASSET_DATA_LARGE_ALIGNMENT]{};
+	fwrite(padding, 1, dataOffset - (stringTableOffset + strings.size()), pFile);
 
-	for (u32 i = 0; i < m_index.Count(); i++) {
-		PoolHandle<AssetEntry> handle = m_index.GetHandle(i);
-		const AssetEntry* asset = m_index.Get(handle);
-		if (asset) {
-			fwrite(asset, sizeof(AssetEntry), 1, pFile);
-		}
+	u64 written = 0;
+	for (u32 i : order) {
+		const ArchiveEntry& entry = entries[i];
+		const size_t storedSize = (entry.flags & ARCHIVE_ENTRY_COMPRESSED) ? entry.compressedSize : entry.size;
+		const u8* pStored = compressedOffsets[i] != SIZE_MAX ? compressedData.data() + compressedOffsets[i] : m_data + m_index.GetDense(i).offset;
+
+		fwrite(padding, 1, entry.offset - written, pFile);
+		fwrite(pStored, 1, storedSize, pFile);
+		written = entry.offset + storedSize;
 	}
 
 	fclose(pFile);
@@ -148,14 +780,22 @@ bool AssetArchive::SaveToFile(const std::filesystem::path& path) {
 }
 
 void* AssetArchive::AddAsset(u64 id, AssetType type, size_t size, const char* path, const void* data) {
-	const AssetEntry* existing = FindAssetByIdBinary(id);
-	if (existing != nullptr) {
+	if (!EnsureWritable() || !InitIndex()) {
+		return nullptr;
+	}
+
+	// Bulk adds check for duplicates once the index is sorted
+	if (!m_bulkAdd && FindAssetByIdBinary(id) != nullptr) {
 		return nullptr; // Asset already exists
 	}
 
-	if (!ReserveMemory(size)) {
+	const size_t offset = AlignUp(m_size, GetAssetAlignment(size));
+	if (!ReserveMemory(offset - m_size + size)) {
 		return nullptr;
 	}
+	// Keep the padding deterministic in saved archives
+	memset(m_data + m_size, 0, offset - m_size);
+	m_size = offset;
 
 	AssetEntry newEntry{};
 	newEntry.id = id;
@@ -167,8 +807,18 @@ void* AssetArchive::AddAsset(u64 id, AssetType type, size_t size, const char* pa
 	newEntry.flags.deleted = false;
 	newEntry.flags.compressed = false;
 
-	m_index.Add(newEntry);
-	m_index.Sort(CompareAssetEntries);
+	if (m_bulkAdd) {
+		if (m_index.Add(newEntry) == PoolHandle<AssetEntry>::Null()) {
+			return nullptr;
+		}
+	}
+	else {
+		if (m_index.InsertSorted(newEntry, CompareAssetEntries) == PoolHandle<AssetEntry>::Null()) {
+			return nullptr;
+		}
+		AddToLookups(newEntry);
+	}
+	MarkModified();
 
 	if (data) {
 		memcpy(m_data + m_size, data, size);
@@ -180,44 +830,148 @@ void* AssetArchive::AddAsset(u64 id, AssetType type, size_t size, const char* pa
 	return m_data + newEntry.offset;
 }
 
-bool AssetArchive::RemoveAsset(u64 id) {
-	AssetEntry* asset = FindAssetByIdBinary(id);
-	if (asset == nullptr) {
+bool AssetArchive::BeginBulkAdd(u32 estimatedCount, size_t estimatedDataSize) {
+	if (!EnsureWritable() || !InitIndex()) {
 		return false;
 	}
 
-	if (asset->flags.deleted) {
+	const u32 count = m_index.Count() + estimatedCount;
+	if (!m_index.Reserve(count) || !m_pathIndex.Reserve(count)) {
 		return false;
 	}
 
-	asset->flags.deleted = true;
-	return true;
+	// Worst case alignment padding for every asset
+	if (!ReserveMemory(estimatedDataSize + estimatedCount * ASSET_DATA_LARGE_ALIGNMENT)) {
+		return false;
+	}
+
+	m_bulkAdd = true;
+	return true;
+}
+
+void AssetArchive::EndBulkAdd() {
+	if (!m_bulkAdd) {
+		return;
+	}
+	m_bulkAdd = false;
+
+	// Stable, so the first asset added with an id comes first
+	m_index.SortByKey(GetAssetEntryKey);
+
+	// Going backwards only swaps already checked entries into the removed slots
+	bool removedDuplicates = false;
+	for (u32 i = m_index.Count() - 1; i > 0 && i < m_index.Count(); i--) {
+		if (m_index.GetDense(i).id == m_index.GetDense(i - 1).id) {
+			m_index.Remove(m_index.GetHandle(i));
+			removedDuplicates = true;
+		}
+	}
+	if (removedDuplicates) {
+		m_index.SortByKey(GetAssetEntryKey);
+	}
+
+	ClearLookups();
+	for (const AssetEntry& entry : m_index) {
+		if (!entry.flags.deleted) {
+			AddToLookups(entry);
+		}
+	}
+	MarkModified();
+}
+
+bool AssetArchive::RemoveAsset(u64 id) {
+	// The mapped entry table doesn't know about deletions
+	if (!EnsureWritable()) {
+		return false;
+	}
+
+	AssetEntry* asset = FindAssetByIdBinary(id);
+	if (asset == nullptr) {
+		return false;
+	}
+
+	if (asset->flags.deleted) {
+		return false;
+	}
+
+	asset->flags.deleted = true;
+	RemoveFromLookups(*asset);
+	MarkModified();
+	return true;
+}
+
+bool AssetArchive::RenameAsset(u64 id, const char* newPath) {
+	AssetEntry* asset = FindAssetByIdBinary(id);
+	if (asset == nullptr || strlen(newPath) >= MAX_ASSET_PATH_LENGTH) {
+		return false;
+	}
+
+	const bool indexed = !asset->flags.deleted;
+	if (indexed) {
+		RemoveFromLookups(*asset);
+	}
+	strcpy(asset->relativePath, newPath);
+	if (indexed) {
+		AddToLookups(*asset);
+	}
+
+	return true;
 }
 
 bool AssetArchive::ResizeAsset(u64 id, size_t newSize) {
+	if (!EnsureWritable()) {
+		return false;
+	}
+
 	AssetEntry* asset = FindAssetByIdBinary(id);
 	if (asset == nullptr) {
 		return false;
 	}
 
+	if (asset->flags.compressed && !DecompressInPlace(asset)) {
+		return false;
+	}
+
 	const size_t oldSize = asset->size;
 
 	if (newSize > oldSize) {
 		// TODO: This could reserve more space than needed to avoid repeated resizes that fragment the memory
-		if (!ReserveMemory(newSize)) {
+		const size_t offset = AlignUp(m_size, GetAssetAlignment(newSize));
+		if (!ReserveMemory(offset - m_size + newSize)) {
 			return false;
 		}
 
-		memcpy(m_data + m_size, m_data + asset->offset, oldSize);
-		asset->offset = m_size;
-		m_size += newSize;
+		memset(m_data + m_size, 0, offset - m_size);
+		memcpy(m_data + offset, m_data + asset->offset, oldSize);
+		memset(m_data + offset + oldSize, 0, newSize - oldSize);
+		asset->offset = offset;
+		m_size = offset + newSize;
 	}
 
 	asset->size = newSize;
+	MarkModified();
 	return true;
 }
 
 void* AssetArchive::GetAssetData(u64 id, AssetType type) {
+	bool cached;
+	return GetAssetData(id, type, cached);
+}
+
+void* AssetArchive::GetAssetData(u64 id, AssetType type, bool& outCached) {
+	outCached = false;
+	if (m_pMappedEntries) {
+		const ArchiveEntry* pEntry = FindArchiveEntry(id);
+		if (pEntry == nullptr || pEntry->type != type || !VerifyArchiveEntry(pEntry)) {
+			return nullptr;
+		}
+		if (pEntry->flags & ARCHIVE_ENTRY_COMPRESSED) {
+			outCached = true;
+			return GetCachedData(id, m_data + pEntry->offset, pEntry->compressedSize, pEntry->size);
+		}
+		return m_data + pEntry->offset;
+	}
+
 	const AssetEntry* asset = FindAssetByIdBinary(id);
 	if (asset == nullptr) {
 		return nullptr;
@@ -225,6 +979,10 @@ void* AssetArchive::GetAssetData(u64 id, AssetType type) {
 	if (asset->flags.type != type || asset->flags.deleted) {
 		return nullptr;
 	}
+	if (asset->flags.compressed) {
+		outCached = true;
+		return GetCachedData(id, m_data + asset->offset, asset->compressedSize, asset->size);
+	}
 
 	return m_data + asset->offset;
 }
@@ -233,19 +991,90 @@ AssetEntry* AssetArchive::GetAssetEntry(u64 id) {
 	return FindAssetByIdBinary(id);
 }
 
-AssetEntry* AssetArchive::GetAssetEntryByPath(const std::filesystem::path& relativePath) {
-	for (u32 i = 0; i < m_index.Count(); i++) {
-		PoolHandle<AssetEntry> handle = m_index.GetHandle(i);
-		AssetEntry* asset = m_index.Get(handle);
-		if (asset && relativePath.compare(asset->relativePath) == 0) {
+AssetEntry* AssetArchive::GetAssetEntryByPath(const char* relativePath) {
+	const u64* pId = m_pathIndex.Get(HashAssetPath(relativePath));
+	if (pId) {
+		AssetEntry* asset = FindAssetByIdBinary(*pId);
+		if (asset && AssetPathsEqual(asset->relativePath, relativePath)) {
 			return asset;
 		}
 	}
+
+	if (m_pathCollisionCount == 0) {
+		return nullptr;
+	}
+
+	for (AssetEntry& asset : m_index) {
+		if (!asset.flags.deleted && AssetPathsEqual(asset.relativePath, relativePath)) {
+			return &asset;
+		}
+	}
 	return nullptr;
 }
 
+AssetEntry* AssetArchive::GetAssetEntryByPath(const std::filesystem::path& relativePath) {
+	return GetAssetEntryByPath(relativePath.string().c_str());
+}
+
+const u64* AssetArchive::GetAssetIdsByType(AssetType type, u32& outCount) const {
+	if (type >= ASSET_TYPE_COUNT) {
+		outCount = 0;
+		return nullptr;
+	}
+
+	outCount = m_typeIds[type].count;
+	return m_typeIds[type].pIds;
+}
+
+void AssetArchive::Prefetch(u64 id) {
+	// Loaded archives are resident already
+	if (!IsMapped()) {
+		return;
+	}
+
+	const u8* pData;
+	size_t size;
+	size_t compressedSize = 0;
+	if (m_pMappedEntries) {
+		// Verifying reads every page of the payload, so only compressed assets have anything left to do
+		const ArchiveEntry* pEntry = FindArchiveEntry(id);
+		if (pEntry == nullptr || !VerifyArchiveEntry(pEntry) || !(pEntry->flags & ARCHIVE_ENTRY_COMPRESSED)) {
+			return;
+		}
+		pData = m_data + pEntry->offset;
+		size = pEntry->size;
+		compressedSize = pEntry->compressedSize;
+	}
+	else {
+		const AssetEntry* asset = FindAssetByIdBinary(id);
+		if (asset == nullptr || asset->flags.deleted) {
+			return;
+		}
+		pData = m_data + asset->offset;
+		size = asset->size;
+		compressedSize = asset->compressedSize;
+	}
+
+	if (compressedSize != 0) {
+		GetCachedData(id, pData, compressedSize, size, false);
+		return;
+	}
+
+	// Reading a byte from every page faults it in
+	volatile u8 sink = 0;
+	for (size_t offset = 0; offset < size; offset += PREFETCH_PAGE_SIZE) {
+		sink = sink + pData[offset];
+	}
+	// The payload doesn't start on a page boundary, so the stride can skip the last page
+	if (size > 0) {
+		sink = sink + pData[size - 1];
+	}
+}
+
 bool AssetArchive::Repack() {
-	size_t newSize = 0;
+	if (!EnsureWritable()) {
+		return false;
+	}
 
 	// Iterate backwards so we can delete entries
 	for (s32 i = m_index.Count() - 1; i >= 0; i--) {
@@ -255,77 +1084,85 @@ bool AssetArchive::Repack() {
 			continue; // Skip null entries
 		}
 
-		if (!asset->flags.deleted) {
-			newSize += asset->size;
-		}
-		else {
+		if (asset->flags.deleted) {
 			m_index.Remove(handle);
 		}
 	}
-	m_index.Sort(CompareAssetEntries);
+	m_index.SortByKey(GetAssetEntryKey);
+
+	size_t newSize = 0;
+	for (const AssetEntry& asset : m_index) {
+		const size_t storedSize = GetStoredSize(asset);
+		newSize = AlignUp(newSize, GetAssetAlignment(storedSize)) + storedSize;
+	}
 
 #ifdef ASSET_ARCHIVE_USE_ARENA
-	// Step 1: Resize the asset data
-	size_t bytesToPush = newSize - m_capacity;
-	if (ArenaAllocator::Push(ARENA_ASSETS, bytesToPush)) {
+	// Step 1: Resize the asset data, only needed if the previous layout had less padding
+	if (newSize > m_capacity && !ResizeStorage(newSize)) {
 		return false;
 	}
 	// Step 2: Get temporary storage for new data
 	ArenaMarker tempMarker = ArenaAllocator::GetMarker(ARENA_SCRATCH);
-	u8* newData = (u8*)ArenaAllocator::Push(ARENA_SCRATCH, newSize);
+	u8* newData = (u8*)ArenaAllocator::Push(ARENA_SCRATCH, newSize, ASSET_DATA_LARGE_ALIGNMENT);
 #else
 	u8* newData = (u8*)malloc(newSize);
 #endif
-	if (!newData) {
+	if (!newData && newSize > 0) {
 		return false;
 	}
 	
 	size_t offset = 0;
-	for (u32 i = 0; i < m_index.Count(); i++) {
-		PoolHandle<AssetEntry> handle = m_index.GetHandle(i);
-		AssetEntry* asset = m_index.Get(handle);
-		if (!asset) {
-			continue; // Skip null entries
-		}
-
-		memcpy(newData + offset, m_data + asset->offset, asset->size);
-		asset->offset = offset;
-		offset += asset->size;
+	for (AssetEntry& asset : m_index) {
+		const size_t storedSize = GetStoredSize(asset);
+		const size_t alignedOffset = AlignUp(offset, GetAssetAlignment(storedSize));
+		memset(newData + offset, 0, alignedOffset - offset);
+		memcpy(newData + alignedOffset, m_data + asset.offset, storedSize);
+		asset.offset = alignedOffset;
+		offset = alignedOffset + storedSize;
 	}
 
 #ifdef ASSET_ARCHIVE_USE_ARENA
-	// Step 3: Copy new data back to the asset arena
-	ArenaMarker assetBaseMarker = ArenaAllocator::GetBaseMarker(ARENA_ASSETS);
-	bool copyResult = ArenaAllocator::Copy(assetBaseMarker, tempMarker, newSize);
+	// Step 3: Copy new data back to the asset storage
+	memcpy(m_data, newData, newSize);
 	// Step 4: Pop the scratch arena
-	ArenaAllocator::Pop(ARENA_SCRATCH, newSize);
-
-	if (!copyResult) {
-		return false;
-	}
+	ArenaAllocator::PopToMarker(ARENA_SCRATCH, tempMarker);
 #else
 	free(m_data);
 	m_data = newData;
+	m_capacity = newSize;
 #endif
 
 	m_size = newSize;
-	m_capacity = newSize;
+	MarkModified();
 
 	return true;
 }
 
 void AssetArchive::Clear() {
-	if (m_data) {
+	if (IsMapped()) {
+		Unmap();
+		m_data = nullptr;
+	}
+
 #ifdef ASSET_ARCHIVE_USE_ARENA
-		ArenaAllocator::Pop(ARENA_ASSETS, m_capacity);
+	// The storage and the cache are the only things in the arena
+	if (m_pArenaBase) {
+		const ArenaMarker current = ArenaAllocator::GetMarker(ARENA_ASSETS);
+		ArenaAllocator::PopToMarker(ARENA_ASSETS, ArenaMarker(current.pArena, m_pArenaBase));
+		m_pArenaBase = nullptr;
+	}
 #else
-		free(m_data);
+	free(m_data);
 #endif
-		m_data = nullptr;
-	}
+	m_data = nullptr;
+	FreeCache();
 	m_capacity = 0;
 	m_size = 0;
-	m_index.Clear();
+	m_bulkAdd = false;
+	if (m_pIndexMemory) {
+		ResetIndex(ASSET_INDEX_INITIAL_CAPACITY);
+	}
+	MarkModified();
 }
 
 size_t AssetArchive::GetAssetCount() const {
@@ -336,6 +1173,414 @@ const AssetIndex& AssetArchive::GetIndex() const {
 	return m_index;
 }
 
+u32 AssetArchive::GetGeneration() const {
+	return m_generation.load(std::memory_order_acquire);
+}
+
+void AssetArchive::MarkModified() {
+	// Skip zero so it can be used as an invalid generation
+	if (m_generation.fetch_add(1, std::memory_order_acq_rel) + 1 == 0) {
+		m_generation.fetch_add(1, std::memory_order_acq_rel);
+	}
+}
+
+u64 AssetArchive::ComputeChecksum(const void* pData, size_t size, u64 seed) {
+	return XXHash64(pData, size, seed);
+}
+
+#pragma region Decompression cache
+// Called while loading, before the storage is allocated, so the storage can keep growing in place behind the cache
+bool AssetArchive::InitCache() {
+	if (m_pCache) {
+		return true;
+	}
+
+#ifdef ASSET_ARCHIVE_USE_ARENA
+	if (!m_pArenaBase) {
+		m_pArenaBase = ArenaAllocator::GetMarker(ARENA_ASSETS).position;
+	}
+	m_pCache = (u8*)ArenaAllocator::Push(ARENA_ASSETS, ASSET_CACHE_SIZE, ASSET_DATA_LARGE_ALIGNMENT);
+#else
+	m_pCache = (u8*)malloc(ASSET_CACHE_SIZE);
+#endif
+	m_cacheEntryCount = 0;
+	m_cacheLookup.Clear();
+	return m_pCache != nullptr;
+}
+
+void AssetArchive::FreeCache() {
+#ifndef ASSET_ARCHIVE_USE_ARENA
+	free(m_pCache);
+#endif
+	m_pCache = nullptr;
+	m_cacheEntryCount = 0;
+	m_cacheLookup.Clear();
+}
+
+// Prefetches neither evict nor pin, entries they add stay evictable until something uses them
+void* AssetArchive::GetCachedData(u64 id, const u8* pCompressed, size_t compressedSize, size_t size, bool evict) {
+	std::lock_guard<std::mutex> lock(m_cacheMutex);
+
+	if (const u32* pIndex = m_cacheLookup.Get(id)) {
+		CacheEntry& entry = m_cacheEntries[*pIndex];
+		entry.lastUsed = ++m_cacheClock;
+		if (evict) {
+			entry.lastUsedFrame = m_cacheFrame;
+		}
+		return m_pCache + entry.offset;
+	}
+
+	if (!m_pCache || size > ASSET_CACHE_SIZE) {
+		return nullptr;
+	}
+
+	// Only entries from earlier frames can be evicted, pointers handed out this frame must stay valid
+	const size_t alignment = GetAssetAlignment(size);
+	u32 offset = 0;
+	while (m_cacheEntryCount >= MAX_ASSET_CACHE_ENTRIES || !FindCacheSpace(size, alignment, offset)) {
+		if (!evict) {
+			return nullptr;
+		}
+
+		u32 leastRecent = m_cacheEntryCount;
+		for (u32 i = 0; i < m_cacheEntryCount; i++) {
+			if (m_cacheEntries[i].lastUsedFrame == m_cacheFrame) {
+				continue;
+			}
+			if (leastRecent == m_cacheEntryCount || m_cacheEntries[i].lastUsed < m_cacheEntries[leastRecent].lastUsed) {
+				leastRecent = i;
+			}
+		}
+		// Everything cached was used this frame
+		if (leastRecent == m_cacheEntryCount) {
+			return nullptr;
+		}
+		EvictCacheEntry(leastRecent);
+	}
+
+	if (!Compression::Decompress(pCompressed, compressedSize, m_pCache + offset, size)) {
+		return nullptr;
+	}
+
+	const u32 index = m_cacheEntryCount++;
+	m_cacheEntries[index] = {
+		.id = id,
+		.offset = offset,
+		.size = (u32)size,
+		.lastUsed = ++m_cacheClock,
+		.lastUsedFrame = evict ? m_cacheFrame : 0,
+	};
+	m_cacheLookup.Add(id, index);
+
+	return m_pCache + offset;
+}
+
+void AssetArchive::AdvanceCacheFrame() {
+	std::lock_guard<std::mutex> lock(m_cacheMutex);
+	// Zero marks entries that were never used, so it's skipped on wrap around
+	if (++m_cacheFrame == 0) {
+		m_cacheFrame = 1;
+	}
+}
+
+// First fit in the gaps between cached entries
+bool AssetArchive::FindCacheSpace(size_t size, size_t alignment, u32& outOffset) const {
+	u32 order[MAX_ASSET_CACHE_ENTRIES];
+	for (u32 i = 0; i < m_cacheEntryCount; i++) {
+		u32 j = i;
+		while (j > 0 && m_cacheEntries[order[j - 1]].offset > m_cacheEntries[i].offset) {
+			order[j] = order[j - 1];
+			j--;
+		}
+		order[j] = i;
+	}
+
+	size_t cursor = 0;
+	for (u32 i = 0; i < m_cacheEntryCount; i++) {
+		const CacheEntry& entry = m_cacheEntries[order[i]];
+		const size_t alignedOffset = AlignUp(cursor, alignment);
+		if (alignedOffset + size <= entry.offset) {
+			outOffset = (u32)alignedOffset;
+			return true;
+		}
+		cursor = entry.offset + entry.size;
+	}
+
+	const size_t alignedOffset = AlignUp(cursor, alignment);
+	if (alignedOffset + size <= ASSET_CACHE_SIZE) {
+		outOffset = (u32)alignedOffset;
+		return true;
+	}
+	return false;
+}
+
+void AssetArchive::EvictCacheEntry(u32 index) {
+	m_cacheLookup.Remove(m_cacheEntries[index].id);
+
+	const u32 last = --m_cacheEntryCount;
+	if (index != last) {
+		m_cacheEntries[index] = m_cacheEntries[last];
+		*m_cacheLookup.Get(m_cacheEntries[index].id) = index;
+	}
+}
+
+// Stores the asset uncompressed at the end of the storage so it can be modified.
+// The compressed payload is left behind until the next repack
+bool AssetArchive::DecompressInPlace(AssetEntry* asset) {
+	const size_t offset = AlignUp(m_size, GetAssetAlignment(asset->size));
+	if (!ReserveMemory(offset - m_size + asset->size)) {
+		return false;
+	}
+
+	memset(m_data + m_size, 0, offset - m_size);
+	if (!Compression::Decompress(m_data + asset->offset, asset->compressedSize, m_data + offset, asset->size)) {
+		return false;
+	}
+
+	asset->offset = offset;
+	asset->compressedSize = 0;
+	asset->flags.compressed = false;
+	m_size = offset + asset->size;
+
+	std::lock_guard<std::mutex> lock(m_cacheMutex);
+	if (const u32* pIndex = m_cacheLookup.Get(asset->id)) {
+		EvictCacheEntry(*pIndex);
+	}
+	MarkModified();
+	return true;
+}
+#pragma endregion
+
+#pragma region Lookups
+void AssetArchive::AddToLookups(const AssetEntry& entry) {
+	const u64 pathHash = HashAssetPath(entry.relativePath);
+	if (!m_pathIndex.Add(pathHash, entry.id)) {
+		// Duplicate paths resolve to the first one added, anything else is a real collision
+		const u64* pExistingId = m_pathIndex.Get(pathHash);
+		const AssetEntry* pExisting = pExistingId ? FindAssetByIdBinary(*pExistingId) : nullptr;
+		if (!pExisting || !AssetPathsEqual(pExisting->relativePath, entry.relativePath)) {
+			m_pathCollisionCount++;
+		}
+	}
+
+	const AssetType type = entry.flags.type;
+	if (type >= ASSET_TYPE_COUNT) {
+		return;
+	}
+
+	AssetIdList& list = m_typeIds[type];
+	if (!ReserveIds(list, list.count + 1)) {
+		return;
+	}
+
+	// Insert sorted, so the lists match index order
+	u32 i = list.count;
+	while (i > 0 && list.pIds[i - 1] > entry.id) {
+		list.pIds[i] = list.pIds[i - 1];
+		i--;
+	}
+	list.pIds[i] = entry.id;
+	list.count++;
+}
+
+void AssetArchive::RemoveFromLookups(const AssetEntry& entry) {
+	const u64 pathHash = HashAssetPath(entry.relativePath);
+	const u64* pIndexedId = m_pathIndex.Get(pathHash);
+	if (pIndexedId && *pIndexedId == entry.id) {
+		m_pathIndex.Remove(pathHash);
+
+		// Another asset with the same path may have been shadowed by this one
+		for (const AssetEntry& other : m_index) {
+			if (other.id != entry.id && !other.flags.deleted && AssetPathsEqual(other.relativePath, entry.relativePath)) {
+				m_pathIndex.Add(pathHash, other.id);
+				break;
+			}
+		}
+	}
+
+	const AssetType type = entry.flags.type;
+	if (type >= ASSET_TYPE_COUNT) {
+		return;
+	}
+
+	AssetIdList& list = m_typeIds[type];
+	for (u32 i = 0; i < list.count; i++) {
+		if (list.pIds[i] == entry.id) {
+			memmove(list.pIds + i, list.pIds + i + 1, (list.count - i - 1) * sizeof(u64));
+			list.count--;
+			break;
+		}
+	}
+}
+
+void AssetArchive::ClearLookups() {
+	m_pathIndex.Clear();
+	m_pathCollisionCount = 0;
+	for (AssetIdList& list : m_typeIds) {
+		list.count = 0;
+	}
+}
+
+// Grows the list in the index arena, the old ids stay there until it's cleared
+bool AssetArchive::ReserveIds(AssetIdList& list, u32 minCapacity) {
+	if (minCapacity <= list.capacity) {
+		return true;
+	}
+
+	u32 newCapacity = list.capacity ? list.capacity * 2 : 64;
+	if (newCapacity < minCapacity) {
+		newCapacity = minCapacity;
+	}
+	u64* pNewIds = (u64*)m_indexArena.Push(sizeof(u64) * newCapacity, alignof(u64), "Asset ids");
+	if (!pNewIds) {
+		return false;
+	}
+	if (list.count > 0) {
+		memcpy(pNewIds, list.pIds, sizeof(u64) * list.count);
+	}
+	list.pIds = pNewIds;
+	list.capacity = newCapacity;
+	return true;
+}
+#pragma endregion
+
+#pragma region Dependencies
+bool AssetArchive::AddBundle(u64 id, u32 firstAsset, u32 assetCount) {
+	if (m_bundleCount >= m_bundleCapacity) {
+		const u32 newCapacity = m_bundleCapacity ? m_bundleCapacity * 2 : 16;
+		ArchiveBundle* pNewBundles = (ArchiveBundle*)m_indexArena.Push(sizeof(ArchiveBundle) * newCapacity, alignof(ArchiveBundle), "Asset bundles");
+		if (!pNewBundles) {
+			return false;
+		}
+		if (m_bundleCount > 0) {
+			memcpy(pNewBundles, m_pBundles, sizeof(ArchiveBundle) * m_bundleCount);
+		}
+		m_pBundles = pNewBundles;
+		m_bundleCapacity = newCapacity;
+	}
+
+	m_pBundles[m_bundleCount++] = { id, firstAsset, assetCount };
+	return true;
+}
+
+// There's one bundle per dungeon or so, not worth indexing
+const AssetArchive::ArchiveBundle* AssetArchive::FindBundle(u64 id) const {
+	for (u32 i = 0; i < m_bundleCount; i++) {
+		if (m_pBundles[i].id == id) {
+			return &m_pBundles[i];
+		}
+	}
+	return nullptr;
+}
+
+const u64* AssetArchive::GetDependencies(u64 id, u32& outCount) const {
+	const AssetEntry* asset = FindAssetByIdBinary(id);
+	if (asset == nullptr || asset->dependencyCount == 0) {
+		outCount = 0;
+		return nullptr;
+	}
+
+	outCount = asset->dependencyCount;
+	return m_dependencyIds.pIds + asset->firstDependency;
+}
+
+u32 AssetArchive::GetDependencyClosure(u64 id, u64* pOutIds, u32 maxCount) const {
+	if (maxCount == 0) {
+		return 0;
+	}
+
+	// The output doubles as the queue
+	u32 count = 0;
+	pOutIds[count++] = id;
+	for (u32 i = 0; i < count; i++) {
+		const AssetEntry* asset = FindAssetByIdBinary(pOutIds[i]);
+		if (asset == nullptr || asset->flags.deleted) {
+			continue;
+		}
+
+		for (u32 d = 0; d < asset->dependencyCount; d++) {
+			const u64 dependency = m_dependencyIds.pIds[asset->firstDependency + d];
+
+			bool visited = false;
+			for (u32 j = 0; j < count && !visited; j++) {
+				visited = pOutIds[j] == dependency;
+			}
+			if (visited) {
+				continue;
+			}
+
+			if (count >= maxCount) {
+				return count;
+			}
+			pOutIds[count++] = dependency;
+		}
+	}
+
+	return count;
+}
+
+const u64* AssetArchive::GetBundle(u64 id, u32& outCount) const {
+	const ArchiveBundle* pBundle = FindBundle(id);
+	if (pBundle == nullptr || pBundle->assetCount == 0) {
+		outCount = 0;
+		return nullptr;
+	}
+
+	outCount = pBundle->assetCount;
+	return m_dependencyIds.pIds + pBundle->firstAsset;
+}
+
+bool AssetArchive::RebuildDependencies(AssetDependencyFn getDependencies, AssetType bundleType) {
+	if (!InitIndex()) {
+		return false;
+	}
+
+	m_dependencyIds.count = 0;
+	m_bundleCount = 0;
+
+	u64 ids[MAX_ASSET_DEPENDENCIES];
+	for (AssetEntry& asset : m_index) {
+		asset.firstDependency = m_dependencyIds.count;
+		asset.dependencyCount = 0;
+		if (asset.flags.deleted) {
+			continue;
+		}
+
+		const void* pData = GetAssetData(asset.id, asset.flags.type);
+		if (pData == nullptr) {
+			continue;
+		}
+
+		const u32 count = getDependencies(asset.flags.type, pData, ids, MAX_ASSET_DEPENDENCIES);
+		if (!ReserveIds(m_dependencyIds, m_dependencyIds.count + count)) {
+			return false;
+		}
+		memcpy(m_dependencyIds.pIds + m_dependencyIds.count, ids, sizeof(u64) * count);
+		asset.dependencyCount = count;
+		m_dependencyIds.count += count;
+	}
+
+	u32 rootCount;
+	const u64* pRoots = GetAssetIdsByType(bundleType, rootCount);
+	const u32 maxBundleSize = m_index.Count();
+	for (u32 i = 0; i < rootCount; i++) {
+		// Collected straight into the list, the closure only reads the dependencies before it
+		if (!ReserveIds(m_dependencyIds, m_dependencyIds.count + maxBundleSize)) {
+			return false;
+		}
+
+		const u32 firstAsset = m_dependencyIds.count;
+		const u32 assetCount = GetDependencyClosure(pRoots[i], m_dependencyIds.pIds + firstAsset, maxBundleSize);
+		m_dependencyIds.count += assetCount;
+		if (!AddBundle(pRoots[i], firstAsset, assetCount)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+#pragma endregion
+
 // Binary search helpers for sorted asset pool
 AssetEntry* AssetArchive::FindAssetByIdBinary(u64 id) {
 	u32 left = 0;
@@ -343,12 +1588,7 @@ AssetEntry* AssetArchive::FindAssetByIdBinary(u64 id) {
 	
 	while (left < right) {
 		u32 mid = left + (right - left) / 2;
-		PoolHandle<AssetEntry> handle = m_index.GetHandle(mid);
-		AssetEntry* entry = m_index.Get(handle);
-		
-		if (!entry) {
-			return nullptr;
-		}
+		AssetEntry* entry = &m_index.GetDense(mid);
 		
 		if (entry->id == id) {
 			return entry;
@@ -368,12 +1608,7 @@ const AssetEntry* AssetArchive::FindAssetByIdBinary(u64 id) const {
 	
 	while (left < right) {
 		u32 mid = left + (right - left) / 2;
-		PoolHandle<AssetEntry> handle = m_index.GetHandle(mid);
-		const AssetEntry* entry = m_index.Get(handle);
-		
-		if (!entry) {
-			return nullptr;
-		}
+		const AssetEntry* entry = &m_index.GetDense(mid);
 		
 		if (entry->id == id) {
 			return entry;
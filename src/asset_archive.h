@@ -2,68 +2,246 @@
 #include "typedef.h"
 #include "asset_types.h"
 #include "memory_pool.h"
+#include "fixed_hash_map.h"
 #include <filesystem>
+#include <mutex>
+#include <atomic>
 
 constexpr u32 MAX_ASSET_PATH_LENGTH = 256;
-constexpr u32 MAX_ASSETS = 1024;
+// The index grows past this as needed
+constexpr u32 ASSET_INDEX_INITIAL_CAPACITY = 1024;
+
+constexpr u32 ASSET_ARCHIVE_VERSION = 4;
+// Payloads are aligned for SIMD loads, larger ones to a cache line
+constexpr size_t ASSET_DATA_ALIGNMENT = 16;
+constexpr size_t ASSET_DATA_LARGE_ALIGNMENT = 64;
+// Compressed assets are decompressed into an LRU cache on access
+constexpr size_t ASSET_CACHE_SIZE = 1024 * 1024; // 1 MB
+constexpr u32 MAX_ASSET_CACHE_ENTRIES = 256;
+// Direct references of a single asset
+constexpr u32 MAX_ASSET_DEPENDENCIES = 1024;
 
 struct AssetFlags {
 	AssetType type : 4;
 	bool deleted : 1;
-	bool compressed : 1; // NOTE: For the future maybe?
+	bool compressed : 1;
 };
 
 struct AssetEntry {
 	u64 id;
 	char relativePath[MAX_ASSET_PATH_LENGTH];
 	size_t offset;
-	size_t size;
+	size_t size; // Uncompressed
+	size_t compressedSize; // Stored size if compressed
+	// Range of directly referenced asset ids in the dependency table
+	u32 firstDependency;
+	u32 dependencyCount;
 	AssetFlags flags;
 };
 
-typedef Pool<AssetEntry, MAX_ASSETS> AssetIndex;
+// Writes the ids of the assets referenced by the asset data to pOutIds and returns how many there are
+typedef u32 (*AssetDependencyFn)(AssetType type, const void* pData, u64* pOutIds, u32 maxCount);
+
+// Growing the index moves the entries, so AssetEntry pointers are only valid until the next asset is added
+typedef DynamicPool<AssetEntry> AssetIndex;
 
 // Self-contained asset archive class without dependencies on debug or random
 class AssetArchive {
 public:
 	AssetArchive();
+	~AssetArchive();
+	AssetArchive(const AssetArchive& other) = delete;
+	AssetArchive& operator=(const AssetArchive& other) = delete;
 
 	// Archive file operations
 	bool LoadFromFile(const std::filesystem::path& path);
-	bool SaveToFile(const std::filesystem::path& path);
+	// Maps the archive read-only instead of copying it, asset data is paged in by the OS on first access.
+	// Pages written to become private copies, and the first add, resize or repack copies the data into owned storage.
+	// Each payload is checked against its checksum on first access or prefetch, and returned as missing if it doesn't match.
+	// Falls back to LoadFromFile where mapping isn't supported
+	bool MapFile(const std::filesystem::path& path);
+	bool IsMapped() const;
+	// With compress, assets of types that are always accessed through GetAssetData are stored compressed
+	// when it saves enough. Assets that are already compressed are written as they are
+	bool SaveToFile(const std::filesystem::path& path, bool compress = false);
 	bool CreateEmpty();
 
 	// Asset operations
+	// Bulk adds append assets without keeping the index sorted and sort once in EndBulkAdd.
+	// Storage is reserved up front from the estimates. Until EndBulkAdd, assets can't be looked up
+	// and duplicate ids aren't rejected; EndBulkAdd keeps the first asset added with an id and removes the rest
+	bool BeginBulkAdd(u32 estimatedCount, size_t estimatedDataSize);
+	void EndBulkAdd();
 	void* AddAsset(u64 id, AssetType type, size_t size, const char* path, const void* data = nullptr);
 	bool RemoveAsset(u64 id);
 	bool ResizeAsset(u64 id, size_t newSize);
+	// Paths must be changed through here to keep the path index up to date
+	bool RenameAsset(u64 id, const char* newPath);
 	
 	// Asset retrieval
+	// Compressed assets are decompressed into the cache, so their data is only valid until the next AdvanceCacheFrame
 	void* GetAssetData(u64 id, AssetType type);
+	// outCached is set if the data was returned from the decompression cache
+	void* GetAssetData(u64 id, AssetType type, bool& outCached);
 	AssetEntry* GetAssetEntry(u64 id);
+	// Hashed lookup, '/' and '\\' separators are treated as equal
+	AssetEntry* GetAssetEntryByPath(const char* relativePath);
 	AssetEntry* GetAssetEntryByPath(const std::filesystem::path& relativePath);
+	// Ids of all assets of a type that haven't been removed, sorted
+	const u64* GetAssetIdsByType(AssetType type, u32& outCount) const;
+	// Dependencies have to be rebuilt after editing assets. The returned ids are valid until the next rebuild or load
+	const u64* GetDependencies(u64 id, u32& outCount) const;
+	// Breadth first, starting with the asset itself. Returns the number of ids written
+	u32 GetDependencyClosure(u64 id, u64* pOutIds, u32 maxCount) const;
+	// Assets in the bundle of an asset, in the order they are laid out in the archive
+	const u64* GetBundle(u64 id, u32& outCount) const;
+
+	// Pages a mapped asset in ahead of its first use, compressed assets are decompressed into the cache if it has room.
+	// Never evicts or moves anything, so it can run on another thread while the game reads assets
+	void Prefetch(u64 id);
+	// Cache entries used during the current frame are never evicted, so call once per frame after everything is drawn
+	void AdvanceCacheFrame();
 	
 	// Archive management
+	// Rebuilds the dependency table with getDependencies, and a bundle of the dependency closure of every asset of bundleType.
+	// Bundles are stored contiguously when saved
+	bool RebuildDependencies(AssetDependencyFn getDependencies, AssetType bundleType);
 	bool Repack();
 	void Clear();
 	
 	// Statistics
 	size_t GetAssetCount() const;
 	const AssetIndex& GetIndex() const;
+
+	// Incremented whenever asset data may have moved or changed, so cached asset pointers can be invalidated
+	u32 GetGeneration() const;
+	void MarkModified();
+
+	// The XXH64 hash the archive uses for payload checksums
+	static u64 ComputeChecksum(const void* pData, size_t size, u64 seed = 0);
 private:
+	// NPAK v4 layout, all fields little-endian:
+	// Header | id sorted entry table | bundle table | dependency id table | path string table | 64-byte aligned data section
+	// Offsets in the entry table are relative to the data section
 	struct ArchiveHeader {
 		char signature[4];
-		size_t assetCount;
-		size_t directoryOffset;
+		u32 version;
+		u32 assetCount;
+		u32 bundleCount;
+		u64 entryTableOffset;
+		u64 bundleTableOffset;
+		u64 dependencyTableOffset;
+		u64 dependencyCount;
+		u64 stringTableOffset;
+		u64 stringTableSize;
+		u64 dataOffset;
+		u64 dataSize;
+	};
+
+	struct ArchiveEntry {
+		u64 id;
+		u64 offset;
+		u64 size; // Uncompressed
+		u64 compressedSize; // Stored size if compressed, otherwise 0
+		u64 checksum; // XXH64 of the stored payload
+		u32 pathOffset; // Into the string table, null terminated
+		u16 pathLength;
+		u8 type;
+		u8 flags;
+		u32 firstDependency; // Into the dependency table
+		u32 dependencyCount;
+	};
+
+	struct ArchiveBundle {
+		u64 id;
+		u32 firstAsset; // Into the dependency table
+		u32 assetCount;
 	};
 
 	size_t m_capacity;
 	size_t m_size;
 	u8* m_data;
 	AssetIndex m_index;
+	// Read by every thread that resolves assets
+	std::atomic<u32> m_generation;
+	bool m_bulkAdd;
+
+	struct AssetIdList {
+		u64* pIds;
+		u32 count;
+		u32 capacity;
+	};
+
+	// The index and lookups grow in their own arena, which is reset by Clear
+	Arena m_indexArena;
+	void* m_pIndexMemory;
+
+	// Lookups kept in sync with the index. Maps path hashes to asset ids
+	DynamicHashMap<u64> m_pathIndex;
+	// Paths that couldn't be indexed because of a hash collision, lookups fall back to a linear search while nonzero
+	u32 m_pathCollisionCount;
+	AssetIdList m_typeIds[ASSET_TYPE_COUNT];
+
+	// Dependency ranges of the entries and bundles point into the same list
+	AssetIdList m_dependencyIds;
+	ArchiveBundle* m_pBundles;
+	u32 m_bundleCount;
+	u32 m_bundleCapacity;
+
+	// Set while m_data points into a file mapping
+	void* m_pMapping;
+	size_t m_mappingSize;
+	// The entry table inside the mapping, searched directly for data lookups
+	const ArchiveEntry* m_pMappedEntries;
+	u32 m_mappedEntryCount;
+	// Set per mapped entry once its payload matched the checksum, any thread can be the first to access it
+	std::atomic<u8>* m_pMappedVerified;
+
+	// Start of everything the archive pushed to ARENA_ASSETS, popped by Clear
+	u8* m_pArenaBase;
+
+	struct CacheEntry {
+		u64 id;
+		u32 offset;
+		u32 size;
+		u64 lastUsed;
+		u32 lastUsedFrame;
+	};
+
+	// Only allocated when the archive has compressed assets
+	u8* m_pCache;
+	CacheEntry m_cacheEntries[MAX_ASSET_CACHE_ENTRIES];
+	u32 m_cacheEntryCount;
+	FixedHashMap<u32, MAX_ASSET_CACHE_ENTRIES * 2> m_cacheLookup;
+	u64 m_cacheClock;
+	u32 m_cacheFrame;
+	// Loading threads may read assets while the main thread does
+	std::mutex m_cacheMutex;
 
 	bool ResizeStorage(size_t minCapacity);
+	static bool ValidateHeader(const ArchiveHeader& header, size_t fileSize);
+	bool ReadIndex(const ArchiveEntry* pEntries, const ArchiveBundle* pBundles, const u64* pDependencies, const char* pStrings, const ArchiveHeader& header, bool& outSorted);
+	const ArchiveEntry* FindArchiveEntry(u64 id) const;
+	bool VerifyArchiveEntry(const ArchiveEntry* pEntry);
+	bool EnsureWritable();
+
+	bool InitIndex();
+	void ResetIndex(u32 capacity);
+	void AddToLookups(const AssetEntry& entry);
+	void RemoveFromLookups(const AssetEntry& entry);
+	void ClearLookups();
+	bool ReserveIds(AssetIdList& list, u32 minCapacity);
+	bool AddBundle(u64 id, u32 firstAsset, u32 assetCount);
+	const ArchiveBundle* FindBundle(u64 id) const;
+	void Unmap();
 	bool ReserveMemory(size_t size);
+
+	bool InitCache();
+	void FreeCache();
+	void* GetCachedData(u64 id, const u8* pCompressed, size_t compressedSize, size_t size, bool evict = true);
+	bool FindCacheSpace(size_t size, size_t alignment, u32& outOffset) const;
+	void EvictCacheEntry(u32 index);
+	bool DecompressInPlace(AssetEntry* asset);
 	static constexpr size_t GetNextPOT(size_t n);
 
 	// Binary search helpers for sorted asset pool
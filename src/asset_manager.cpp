@@ -1,24 +1,132 @@
+#ifdef PLATFORM_WINDOWS
+	#include <windows.h>
+#elif PLATFORM_LINUX
+	#include <pthread.h>
+#endif
+
 #include "asset_manager.h"
 #include "random.h"
 #include <cstdio>
 #include <cstring>
+#include <thread>
+#include <condition_variable>
 
 static AssetArchive g_archive;
 
+#pragma region Resolution
+// Resolved asset pointers, direct mapped by the low bits of the id since ids are random.
+// Per thread so the game, audio and worker threads can all resolve without locking
+static constexpr u32 RESOLVED_ASSET_SLOT_COUNT = 1024;
+
+struct ResolvedAsset {
+	u64 id;
+	void* pData;
+	u32 generation;
+	AssetType type;
+};
+
+static thread_local ResolvedAsset t_resolvedAssets[RESOLVED_ASSET_SLOT_COUNT];
+#pragma endregion
+
+#pragma region Prefetching
+// Prefetches are hints, anything that doesn't fit in the queue is dropped
+static constexpr u32 MAX_PREFETCH_QUEUE_SIZE = 1024;
+
+static u64 g_prefetchQueue[MAX_PREFETCH_QUEUE_SIZE];
+static u32 g_prefetchHead = 0;
+static u32 g_prefetchCount = 0;
+static bool g_prefetchBusy = false;
+
+static std::thread g_ioThread;
+static std::condition_variable g_ioCondition;
+static std::condition_variable g_prefetchDoneCondition;
+static std::mutex g_ioMutex;
+static bool g_stopIoThread = false;
+
+static void IoThreadLoop() {
+#ifdef PLATFORM_WINDOWS
+	SetThreadDescription(GetCurrentThread(), L"AssetIO");
+#elif PLATFORM_LINUX
+	pthread_setname_np(pthread_self(), "AssetIO");
+#endif
+
+	while (true) {
+		u64 id;
+		{
+			std::unique_lock<std::mutex> lock(g_ioMutex);
+			g_prefetchBusy = false;
+			if (g_prefetchCount == 0) {
+				g_prefetchDoneCondition.notify_all();
+			}
+
+			while (g_prefetchCount == 0 && !g_stopIoThread) {
+				g_ioCondition.wait(lock);
+			}
+
+			if (g_stopIoThread) {
+				return;
+			}
+
+			id = g_prefetchQueue[g_prefetchHead];
+			g_prefetchHead = (g_prefetchHead + 1) % MAX_PREFETCH_QUEUE_SIZE;
+			g_prefetchCount--;
+			g_prefetchBusy = true;
+		}
+
+		g_archive.Prefetch(id);
+	}
+}
+
+static void StopIoThread() {
+	if (!g_ioThread.joinable()) {
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(g_ioMutex);
+		g_stopIoThread = true;
+		g_prefetchCount = 0;
+	}
+	g_ioCondition.notify_all();
+	g_ioThread.join();
+	g_stopIoThread = false;
+	g_prefetchBusy = false;
+}
+
+// The archive must not change under a prefetch
+static void FinishPrefetching() {
+	if (!g_ioThread.joinable()) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(g_ioMutex);
+	while (g_prefetchCount > 0 || g_prefetchBusy) {
+		g_prefetchDoneCondition.wait(lock);
+	}
+}
+#pragma endregion
+
 #pragma region Public API
 void AssetManager::Free() {
+	StopIoThread();
 	g_archive.Clear();
 }
 
-bool AssetManager::LoadArchive(const std::filesystem::path& path) {
+bool AssetManager::LoadArchive(const std::filesystem::path& path, bool memoryMapped) {
+	StopIoThread();
+	if (memoryMapped) {
+		return g_archive.MapFile(path);
+	}
 	return g_archive.LoadFromFile(path);
 }
 
 bool AssetManager::SaveArchive(const std::filesystem::path& path) {
+	FinishPrefetching();
 	return g_archive.SaveToFile(path);
 }
 
 bool AssetManager::RepackArchive() {
+	FinishPrefetching();
 	g_archive.Repack();
 	return true;
 }
@@ -26,6 +134,7 @@ bool AssetManager::RepackArchive() {
 u64 AssetManager::CreateAsset(AssetType type, size_t size, const char* path) {
 	DEBUG_LOG("Creating new asset of size %d with path %s\n", size, path);
 
+	FinishPrefetching();
 	const u64 id = Random::GenerateUUID();
 	void* data = g_archive.AddAsset(id, type, size, path, nullptr);
 	if (!data) {
@@ -35,11 +144,23 @@ u64 AssetManager::CreateAsset(AssetType type, size_t size, const char* path) {
 	return id;
 }
 
-void* AssetManager::AddAsset(u64 id, AssetType type, size_t size, const char* path, void* data) {
+bool AssetManager::BeginBulkAdd(u32 estimatedCount, size_t estimatedDataSize) {
+	FinishPrefetching();
+	return g_archive.BeginBulkAdd(estimatedCount, estimatedDataSize);
+}
+
+void AssetManager::EndBulkAdd() {
+	FinishPrefetching();
+	g_archive.EndBulkAdd();
+}
+
+void* AssetManager::AddAsset(u64 id, AssetType type, size_t size, const char* path, const void* data) {
+	FinishPrefetching();
 	return g_archive.AddAsset(id, type, size, path, data);
 }
 
 bool AssetManager::RemoveAsset(u64 id) {
+	FinishPrefetching();
 	if (!g_archive.RemoveAsset(id)) {
 		DEBUG_ERROR("Asset with ID %llu does not exist\n", id);
 		return false;
@@ -55,12 +176,23 @@ bool AssetManager::ResizeAsset(u64 id, size_t newSize) {
 		return false;
 	}
 	
+	FinishPrefetching();
 	const size_t oldSize = asset->size;
 	DEBUG_LOG("Resizing asset %lld (%d -> %d)\n", id, oldSize, newSize);
 
 	return g_archive.ResizeAsset(id, newSize);
 }
 
+bool AssetManager::RenameAsset(u64 id, const char* newPath) {
+	FinishPrefetching();
+	if (!g_archive.RenameAsset(id, newPath)) {
+		DEBUG_ERROR("Failed to rename asset %llu to '%s'\n", id, newPath);
+		return false;
+	}
+
+	return true;
+}
+
 u64 AssetManager::GetAssetIdFromPath(const std::filesystem::path& relativePath) {
 	AssetEntry* pAssetInfo = GetAssetInfoFromPath(relativePath);
 	if (!pAssetInfo) {
@@ -83,8 +215,79 @@ u64 AssetManager::GetAssetIdFromPath(const std::filesystem::path& relativePath,
 	return pAssetInfo->id;
 }
 
+void AssetManager::Prefetch(const u64* pIds, u32 count) {
+	// Loaded archives are resident already
+	if (!g_archive.IsMapped()) {
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(g_ioMutex);
+		for (u32 i = 0; i < count && g_prefetchCount < MAX_PREFETCH_QUEUE_SIZE; i++) {
+			if (pIds[i] == UUID_NULL) {
+				continue;
+			}
+			g_prefetchQueue[(g_prefetchHead + g_prefetchCount) % MAX_PREFETCH_QUEUE_SIZE] = pIds[i];
+			g_prefetchCount++;
+		}
+	}
+
+	// Started on first use, so builds that never prefetch don't get the thread
+	if (!g_ioThread.joinable()) {
+		g_ioThread = std::thread(IoThreadLoop);
+	}
+	g_ioCondition.notify_one();
+}
+
+void AssetManager::PrefetchWithDependencies(u64 id) {
+	if (!g_archive.IsMapped()) {
+		return;
+	}
+
+	u64 ids[MAX_PREFETCH_QUEUE_SIZE];
+	const u32 count = g_archive.GetDependencyClosure(id, ids, MAX_PREFETCH_QUEUE_SIZE);
+	Prefetch(ids, count);
+}
+
+bool AssetManager::PrefetchBundle(u64 id) {
+	u32 count;
+	const u64* pIds = g_archive.GetBundle(id, count);
+	if (!pIds) {
+		return false;
+	}
+
+	Prefetch(pIds, count);
+	return true;
+}
+
+void AssetManager::EndFrame() {
+	g_archive.AdvanceCacheFrame();
+}
+
+bool AssetManager::RebuildDependencies(AssetDependencyFn getDependencies) {
+	FinishPrefetching();
+	return g_archive.RebuildDependencies(getDependencies, ASSET_TYPE_DUNGEON);
+}
+
+const u64* AssetManager::GetDependencies(u64 id, u32& outCount) {
+	return g_archive.GetDependencies(id, outCount);
+}
+
 void* AssetManager::GetAsset(u64 id, AssetType type) {
-	return g_archive.GetAssetData(id, type);
+	// Read before resolving, so a change in between leaves the slot stale instead of wrong
+	const u32 generation = g_archive.GetGeneration();
+	ResolvedAsset& slot = t_resolvedAssets[id & (RESOLVED_ASSET_SLOT_COUNT - 1)];
+	if (slot.id == id && slot.generation == generation && slot.type == type) {
+		return slot.pData;
+	}
+
+	// Decompressed assets aren't kept, so every use marks them recently used and pins them in the cache for this frame
+	bool cached;
+	void* pData = g_archive.GetAssetData(id, type, cached);
+	if (pData && !cached) {
+		slot = { id, pData, generation, type };
+	}
+	return pData;
 }
 
 AssetEntry* AssetManager::GetAssetInfo(u64 id) {
@@ -101,19 +304,22 @@ AssetEntry* AssetManager::GetAssetInfoFromPath(const std::filesystem::path& rela
 
 // If ppOutEntries is nullptr, returns the count of assets of that type
 void AssetManager::GetAllAssetInfosByType(AssetType type, size_t& count, const AssetEntry** ppOutEntries) {
-	const AssetIndex& index = g_archive.GetIndex();
-	count = 0;
-	for (size_t i = 0; i < index.Count(); ++i) {
-		const AssetEntry* pEntry = index.Get(index.GetHandle(i));
-		if (pEntry && pEntry->flags.type == type) {
-			if (ppOutEntries) {
-				ppOutEntries[count] = pEntry;
-			}
-			count++;
-		}
+	u32 idCount;
+	const u64* pIds = g_archive.GetAssetIdsByType(type, idCount);
+	count = idCount;
+	if (!ppOutEntries) {
+		return;
+	}
+
+	for (u32 i = 0; i < idCount; i++) {
+		ppOutEntries[i] = g_archive.GetAssetEntry(pIds[i]);
 	}
 }
 
+const u64* AssetManager::GetAssetIdsByType(AssetType type, u32& outCount) {
+	return g_archive.GetAssetIdsByType(type, outCount);
+}
+
 size_t AssetManager::GetAssetCount() {
 	return g_archive.GetAssetCount();
 }
@@ -121,4 +327,12 @@ size_t AssetManager::GetAssetCount() {
 const AssetIndex& AssetManager::GetIndex() {
 	return g_archive.GetIndex();
 }
+
+u32 AssetManager::GetGeneration() {
+	return g_archive.GetGeneration();
+}
+
+void AssetManager::MarkAssetsModified() {
+	g_archive.MarkModified();
+}
 #pragma endregion
\ No newline at end of file
@@ -7,7 +7,8 @@
 
 namespace AssetManager {
 	void Free();
-	bool LoadArchive(const std::filesystem::path& path);
+	// Memory mapped archives are paged in on demand instead of read up front
+	bool LoadArchive(const std::filesystem::path& path, bool memoryMapped = false);
 	bool SaveArchive(const std::filesystem::path& path);
 	bool RepackArchive();
 
@@ -19,10 +20,14 @@ namespace AssetManager {
 		return HandleType{ id };
 	}
 
-	void* AddAsset(u64 id, AssetType type, size_t size, const char* path, void* data = nullptr);
+	// See AssetArchive::BeginBulkAdd, assets can't be looked up until EndBulkAdd
+	bool BeginBulkAdd(u32 estimatedCount, size_t estimatedDataSize);
+	void EndBulkAdd();
+	void* AddAsset(u64 id, AssetType type, size_t size, const char* path, const void* data = nullptr);
 	bool RemoveAsset(u64 id);
 
 	bool ResizeAsset(u64 id, size_t newSize);
+	bool RenameAsset(u64 id, const char* newPath);
 
 	u64 GetAssetIdFromPath(const std::filesystem::path& relativePath);
 	u64 GetAssetIdFromPath(const std::filesystem::path& relativePath, AssetType type);
@@ -40,11 +45,30 @@ namespace AssetManager {
 		return (T*)GetAsset(handle.id, assetType);
 	}
 
+	// Queues assets to be paged in on the I/O thread ahead of use, e.g. during a transition.
+	// Only does anything for memory mapped archives, which are otherwise paged in on first access
+	void Prefetch(const u64* pIds, u32 count);
+	// Prefetches the asset and everything it references
+	void PrefetchWithDependencies(u64 id);
+	// Prefetches the bundle built for an asset, in archive order. Returns false if there's no bundle
+	bool PrefetchBundle(u64 id);
+	// Call once per frame, compressed assets resolved during the frame are only valid until then
+	void EndFrame();
+
+	// Bundles are built for dungeons
+	bool RebuildDependencies(AssetDependencyFn getDependencies);
+	const u64* GetDependencies(u64 id, u32& outCount);
+
 	AssetEntry* GetAssetInfo(u64 id);
 	AssetEntry* GetAssetInfoFromPath(const std::filesystem::path& relativePath);
 
 	void GetAllAssetInfosByType(AssetType type, size_t& count, const AssetEntry** ppOutEntries);
+	const u64* GetAssetIdsByType(AssetType type, u32& outCount);
 
 	size_t GetAssetCount();
 	const AssetIndex& GetIndex();
+
+	u32 GetGeneration();
+	// Call after writing to asset data directly. Refreshes cached pointers to every asset, not only the written one
+	void MarkAssetsModified();
 }
\ No newline at end of file
@@ -4,8 +4,15 @@
 #include "core_types.h"
 #include "data_types.h"
 #include "actor_data.h"
+#include "asset_archive.h"
+#include "memory_arena.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 static constexpr u64 ASSET_FILE_FORMAT_VERSION = 1;
+// Bump when the serialized layout of any asset type changes, so cached assets get rebuilt
+static constexpr u32 ASSET_SERIALIZER_VERSION = 2;
 
 #pragma region JSON Helpers
 
@@ -658,6 +665,11 @@ static SerializationResult LoadActorPrototypeFromFile(FILE* pFile, const nlohman
 		return SERIALIZATION_INVALID_ASSET_DATA; // Invalid subtype
 	}
 
+	const u32 activation = json.contains("activation") ? json["activation"].get<u32>() : ACTOR_ACTIVATION_DEFAULT;
+	if (activation >= ACTOR_ACTIVATION_COUNT) {
+		return SERIALIZATION_INVALID_ASSET_DATA; // Invalid activation
+	}
+	pProto->activation = (u8)activation;
 	json["hitbox"].get_to(pProto->hitbox);
 
 	memset(&pProto->data, 0, sizeof(pProto->data));
@@ -700,6 +712,7 @@ static SerializationResult SaveActorPrototypeToFile(FILE* pFile, nlohmann::json&
 		return SERIALIZATION_INVALID_ASSET_DATA; // Invalid subtype index
 	}
 
+	json["activation"] = pProto->activation;
 	json["hitbox"] = pProto->hitbox;
 
 	// Serialize properties
@@ -750,15 +763,14 @@ static bool ValidateTilemapJson(const nlohmann::json& json, u32& outWidth, u32&
 
 static SerializationResult LoadRoomTemplateFromFile(FILE* pFile, const nlohmann::json& metadata, std::vector<u8>& outData) {
 	const nlohmann::json json = nlohmann::json::parse(pFile);
-	const u8 width = json["width"] != nullptr ? json["width"].get<u8>() : 0;
-	const u8 height = json["height"] != nullptr ? json["height"].get<u8>() : 0;
+	const u32 width = json["width"] != nullptr ? json["width"].get<u32>() : 0;
+	const u32 height = json["height"] != nullptr ? json["height"].get<u32>() : 0;
+	if (width == 0 || height == 0 || width > ROOM_MAX_DIM_SCREENS || height > ROOM_MAX_DIM_SCREENS) {
+		return SERIALIZATION_INVALID_ASSET_DATA; // Invalid room size
+	}
 
 	const nlohmann::json mapTilesJson = json["map_tiles"];
 	const size_t mapTileCount = mapTilesJson != nullptr && mapTilesJson.is_array() ? mapTilesJson.size() : 0;
-	const u32 expectedMapTileCount = ROOM_MAP_TILE_COUNT;
-	if (mapTileCount != expectedMapTileCount) {
-		return SERIALIZATION_INVALID_ASSET_DATA; // Invalid map tile count
-	}
 
 	const nlohmann::json actorsJson = json["actors"];
 	const size_t actorCount = actorsJson != nullptr && actorsJson.is_array() ? actorsJson.size() : 0;
@@ -769,36 +781,30 @@ static SerializationResult LoadRoomTemplateFromFile(FILE* pFile, const nlohmann:
 		return SERIALIZATION_INVALID_ASSET_DATA; // Invalid tilemap data
 	}
 
-	const u32 expectedTilemapWidth = ROOM_MAX_DIM_SCREENS * VIEWPORT_WIDTH_METATILES;
-	if (tilemapWidth != expectedTilemapWidth) {
-		return SERIALIZATION_INVALID_ASSET_DATA; // Invalid tilemap width
-	}
+	// Rooms used to be stored at the maximum size, those are cropped to the screens the room covers
+	const bool fullSize = tilemapWidth == ROOM_MAX_DIM_SCREENS * VIEWPORT_WIDTH_METATILES &&
+		tilemapHeight == ROOM_MAX_DIM_SCREENS * VIEWPORT_HEIGHT_METATILES &&
+		mapTileCount == ROOM_MAP_TILE_COUNT;
 
-	const u32 expectedTilemapHeight = ROOM_MAX_DIM_SCREENS * VIEWPORT_HEIGHT_METATILES;
-	if (tilemapHeight != expectedTilemapHeight) {
-		return SERIALIZATION_INVALID_ASSET_DATA; // Invalid tilemap height
-	}
+	const u32 roomTilemapWidth = width * VIEWPORT_WIDTH_METATILES;
+	const u32 roomTilemapHeight = height * VIEWPORT_HEIGHT_METATILES;
+	if (!fullSize) {
+		if (tilemapWidth != roomTilemapWidth || tilemapHeight != roomTilemapHeight) {
+			return SERIALIZATION_INVALID_ASSET_DATA; // Tilemap doesn't match the room size
+		}
 
-	const u32 expectedTileCount = ROOM_MAX_SCREEN_COUNT * ROOM_SCREEN_TILE_COUNT;
-	if (tileCount != expectedTileCount) {
-		return SERIALIZATION_INVALID_ASSET_DATA; // Invalid tile count
+		if (mapTileCount != width * height * 2) {
+			return SERIALIZATION_INVALID_ASSET_DATA; // Invalid map tile count
+		}
 	}
 
-	const size_t size = sizeof(RoomTemplate) +
-		ROOM_MAX_SCREEN_COUNT * ROOM_SCREEN_TILE_COUNT +
-		mapTileCount * sizeof(BgTile) +
-		actorCount * sizeof(RoomActor);
-
-	outData.resize(size);
-
-	const u32 mapTileOffset = sizeof(RoomTemplate);
-	const u32 tilesOffset = mapTileOffset + ROOM_MAP_TILE_COUNT * sizeof(BgTile);
-	const u32 actorOffset = tilesOffset + tileCount;
+	const RoomTemplateLayout layout = GetRoomTemplateLayout(width, height, (u32)actorCount);
+	outData.assign(layout.size, 0);
 
 	RoomTemplate* pRoom = (RoomTemplate*)outData.data();
-	pRoom->width = width;
-	pRoom->height = height;
-	pRoom->mapTileOffset = mapTileOffset;
+	pRoom->width = (u8)width;
+	pRoom->height = (u8)height;
+	pRoom->mapTileOffset = layout.mapTileOffset;
 
 	if (json.contains("map_chr_bank_id") && json["map_chr_bank_id"] != nullptr) {
 		json["map_chr_bank_id"].get_to<u64>(pRoom->mapChrBankHandle.id);
@@ -808,29 +814,34 @@ static SerializationResult LoadRoomTemplateFromFile(FILE* pFile, const nlohmann:
 	}
 
 	Tilemap& tilemap = pRoom->tilemap;
-	tilemap.width = tilemapWidth;
-	tilemap.height = tilemapHeight;
+	tilemap.width = roomTilemapWidth;
+	tilemap.height = roomTilemapHeight;
 	tilemap.tilesetHandle.id = tilemapJson["tileset_id"].get<u64>();
-	tilemap.tilesOffset = tilesOffset - offsetof(RoomTemplate, tilemap);
+	tilemap.tilesOffset = layout.tilesOffset - offsetof(RoomTemplate, tilemap);
 
 	pRoom->actorCount = (u32)actorCount;
-	pRoom->actorOffset = actorOffset;
+	pRoom->actorOffset = layout.actorOffset;
 
 	// Load map tiles
-	BgTile* pMapTiles = (BgTile*)((u8*)pRoom + mapTileOffset);
-	for (u32 i = 0; i < mapTileCount && i < mapTilesJson.size(); i++) {
-		mapTilesJson[i].get_to(pMapTiles[i]);
+	BgTile* pMapTiles = pRoom->GetMapTiles();
+	const u32 mapTileStride = fullSize ? ROOM_MAX_DIM_SCREENS * 2 : width * 2;
+	for (u32 y = 0; y < height; y++) {
+		for (u32 x = 0; x < width * 2; x++) {
+			mapTilesJson[x + y * mapTileStride].get_to(pMapTiles[x + y * width * 2]);
+		}
 	}
 
 	// Load room tiles
-	u8* pTiles = (u8*)pRoom + tilesOffset;
+	u8* pTiles = tilemap.GetTileData();
 	const nlohmann::json& tilesJson = tilemapJson["tiles"];
-	for (u32 i = 0; i < tileCount && i < tilesJson.size(); i++) {
-		tilesJson[i].get_to(pTiles[i]);
+	for (u32 y = 0; y < roomTilemapHeight; y++) {
+		for (u32 x = 0; x < roomTilemapWidth; x++) {
+			tilesJson[x + y * tilemapWidth].get_to(pTiles[x + y * roomTilemapWidth]);
+		}
 	}
 
 	// Load actors
-	RoomActor* pActors = (RoomActor*)((u8*)pRoom + actorOffset);
+	RoomActor* pActors = pRoom->GetActors();
 	for (u32 i = 0; i < actorCount; i++) {
 		actorsJson[i].get_to(pActors[i]);
 	}
@@ -853,8 +864,8 @@ static SerializationResult SaveRoomTemplateToFile(FILE* pFile, nlohmann::json& m
 
 	// Serialize map tiles
 	json["map_tiles"] = nlohmann::json::array();
-	const BgTile* pMapTiles = (const BgTile*)((const u8*)pRoom + pRoom->mapTileOffset);
-	for (u32 i = 0; i < ROOM_MAP_TILE_COUNT; i++) {
+	const BgTile* pMapTiles = pRoom->GetMapTiles();
+	for (u32 i = 0; i < pRoom->GetMapTileCount(); i++) {
 		json["map_tiles"].push_back(pMapTiles[i]);
 	}
 
@@ -1045,6 +1056,107 @@ static SerializationResult SaveShaderToFile(FILE* pFile, nlohmann::json& metadat
 
 #pragma endregion
 
+#pragma region Dependencies
+static void AddDependency(u64 id, u64* pOutIds, u32& count, u32 maxCount) {
+	if (id == UUID_NULL || count >= maxCount) {
+		return;
+	}
+	for (u32 i = 0; i < count; i++) {
+		if (pOutIds[i] == id) {
+			return;
+		}
+	}
+	pOutIds[count++] = id;
+}
+
+static void GetActorPrototypeDependencies(const ActorPrototype* pProto, u64* pOutIds, u32& count, u32 maxCount) {
+	const AnimationHandle* pAnims = pProto->GetAnimations();
+	for (u32 i = 0; i < pProto->animCount; i++) {
+		AddDependency(pAnims[i].id, pOutIds, count, maxCount);
+	}
+
+	if (pProto->type >= ACTOR_TYPE_COUNT) {
+		return;
+	}
+	const ActorTypeReflectionData& editorData = ACTOR_REFLECTION_DATA[pProto->type];
+	if (pProto->subtype >= editorData.subtypeCount) {
+		return;
+	}
+
+	// Asset properties are handles, which are just the id
+	for (u32 i = 0; i < editorData.propertyCounts[pProto->subtype]; i++) {
+		const ActorProperty& prop = editorData.subtypeProperties[pProto->subtype][i];
+		if (prop.type != ACTOR_PROPERTY_ASSET) {
+			continue;
+		}
+
+		const u8* pPropertyData = (const u8*)&pProto->data + prop.offset;
+		for (s32 c = 0; c < prop.components; c++) {
+			u64 id;
+			memcpy(&id, pPropertyData + c * sizeof(u64), sizeof(u64));
+			AddDependency(id, pOutIds, count, maxCount);
+		}
+	}
+}
+
+u32 AssetSerialization::GetAssetDependencies(AssetType type, const void* pData, u64* pOutIds, u32 maxCount) {
+	if (!pData) {
+		return 0;
+	}
+
+	u32 count = 0;
+	switch (type) {
+	case (ASSET_TYPE_METASPRITE): {
+		AddDependency(((const Metasprite*)pData)->chrBankHandle.id, pOutIds, count, maxCount);
+		break;
+	}
+	case (ASSET_TYPE_TILESET): {
+		AddDependency(((const Tileset*)pData)->chrBankHandle.id, pOutIds, count, maxCount);
+		break;
+	}
+	case (ASSET_TYPE_ANIMATION): {
+		const Animation* pAnimation = (const Animation*)pData;
+		const AnimationFrame* pFrames = pAnimation->GetFrames();
+		for (u32 i = 0; i < pAnimation->frameCount; i++) {
+			AddDependency(pFrames[i].metaspriteId.id, pOutIds, count, maxCount);
+		}
+		break;
+	}
+	case (ASSET_TYPE_ACTOR_PROTOTYPE): {
+		GetActorPrototypeDependencies((const ActorPrototype*)pData, pOutIds, count, maxCount);
+		break;
+	}
+	case (ASSET_TYPE_ROOM_TEMPLATE): {
+		const RoomTemplate* pTemplate = (const RoomTemplate*)pData;
+		AddDependency(pTemplate->tilemap.tilesetHandle.id, pOutIds, count, maxCount);
+		AddDependency(pTemplate->mapChrBankHandle.id, pOutIds, count, maxCount);
+
+		const RoomActor* pActors = pTemplate->GetActors();
+		for (u32 i = 0; i < pTemplate->actorCount; i++) {
+			AddDependency(pActors[i].prototypeHandle.id, pOutIds, count, maxCount);
+		}
+		break;
+	}
+	case (ASSET_TYPE_DUNGEON): {
+		const Dungeon* pDungeon = (const Dungeon*)pData;
+		for (u32 i = 0; i < pDungeon->roomCount && i < MAX_DUNGEON_ROOM_COUNT; i++) {
+			AddDependency(pDungeon->rooms[i].templateId.id, pOutIds, count, maxCount);
+		}
+		break;
+	}
+	case (ASSET_TYPE_OVERWORLD): {
+		// Dungeons entered from the overworld are loaded through their own bundles
+		AddDependency(((const Overworld*)pData)->tilemap.tilesetHandle.id, pOutIds, count, maxCount);
+		break;
+	}
+	default:
+		break;
+	}
+
+	return count;
+}
+#pragma endregion
+
 SerializationResult AssetSerialization::TryGetAssetTypeFromPath(const std::filesystem::path& path, AssetType& outType) {
 	for (u32 i = 0; i < ASSET_TYPE_COUNT; i++) {
 		if (path.extension() == ASSET_TYPE_FILE_EXTENSIONS[i]) {
@@ -1246,4 +1358,288 @@ SerializationResult AssetSerialization::SaveAssetToFile(const std::filesystem::p
 
 	fclose(pFile);
 	return saveResult;
-}
\ No newline at end of file
+}
+
+#pragma region Cache
+// Modification times and sizes of an asset source and its metadata
+struct AssetSourceStamp {
+	s64 sourceWriteTime;
+	s64 metadataWriteTime;
+	u64 sourceSize;
+	u64 metadataSize;
+
+	bool operator==(const AssetSourceStamp& other) const = default;
+};
+
+struct AssetCacheHeader {
+	char signature[4];
+	u32 serializerVersion;
+	u64 sourceHash;
+	AssetSourceStamp stamp; // When the source was hashed
+	u64 id;
+	u64 size;
+	u64 checksum;
+	u32 type;
+	u32 reserved;
+};
+
+static constexpr char ASSET_CACHE_SIGNATURE[4] = { 'N', 'A', 'C', 'H' };
+
+// Returns nullptr if the file doesn't fit in the scratch arena
+static const u8* ReadFileToScratch(ScratchScope& scratch, const std::filesystem::path& path, size_t& outSize) {
+	FILE* pFile = fopen(path.string().c_str(), "rb");
+	if (!pFile) {
+		return nullptr;
+	}
+
+	fseek(pFile, 0, SEEK_END);
+	const long size = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+	if (size < 0 || (size_t)size > scratch.GetArena()->GetRemainingBytes()) {
+		fclose(pFile);
+		return nullptr;
+	}
+
+	u8* pData = (u8*)scratch.Push(size, 1);
+	const bool result = fread(pData, 1, size, pFile) == (size_t)size;
+	fclose(pFile);
+
+	outSize = size;
+	return result ? pData : nullptr;
+}
+
+static bool GetAssetSourceStamp(const std::filesystem::path& path, AssetSourceStamp& outStamp) {
+	const std::filesystem::path metadataPath = AssetSerialization::GetAssetMetadataPath(path);
+
+	std::error_code err;
+	outStamp.sourceWriteTime = std::filesystem::last_write_time(path, err).time_since_epoch().count();
+	if (err) {
+		return false;
+	}
+	outStamp.metadataWriteTime = std::filesystem::last_write_time(metadataPath, err).time_since_epoch().count();
+	if (err) {
+		return false;
+	}
+	outStamp.sourceSize = std::filesystem::file_size(path, err);
+	if (err) {
+		return false;
+	}
+	outStamp.metadataSize = std::filesystem::file_size(metadataPath, err);
+	return !err;
+}
+
+static bool HashAssetSource(const std::filesystem::path& path, u64& outHash) {
+	// Runs on the loading threads, so the contents go to the thread's scratch arena
+	ScratchScope scratch;
+	size_t metadataSize, sourceSize;
+	const u8* pMetadata = ReadFileToScratch(scratch, AssetSerialization::GetAssetMetadataPath(path), metadataSize);
+	if (!pMetadata) {
+		return false;
+	}
+	const u64 metadataHash = AssetArchive::ComputeChecksum(pMetadata, metadataSize);
+
+	const u8* pSource = ReadFileToScratch(scratch, path, sourceSize);
+	if (!pSource) {
+		return false;
+	}
+	outHash = AssetArchive::ComputeChecksum(pSource, sourceSize, metadataHash);
+	return true;
+}
+
+static bool WriteCachedAsset(const std::filesystem::path& cachePath, const AssetCacheHeader& header, const u8* pData) {
+	std::error_code err;
+	std::filesystem::create_directories(cachePath.parent_path(), err);
+
+	FILE* pFile = fopen(cachePath.string().c_str(), "wb");
+	if (!pFile) {
+		return false;
+	}
+
+	const bool written = fwrite(&header, sizeof(AssetCacheHeader), 1, pFile) == 1 &&
+		fwrite(pData, 1, header.size, pFile) == header.size;
+	fclose(pFile);
+
+	if (!written) {
+		std::filesystem::remove(cachePath, err);
+	}
+	return written;
+}
+
+std::filesystem::path AssetSerialization::GetCachedAssetPath(const std::filesystem::path& cacheDirectory, const std::filesystem::path& sourcePath) {
+	// The same source maps to the same entry whatever the working directory or separators
+	const std::string pathStr = std::filesystem::absolute(sourcePath).lexically_normal().generic_string();
+	char filename[32];
+	snprintf(filename, sizeof(filename), "%016llx.bin", (unsigned long long)AssetArchive::ComputeChecksum(pathStr.data(), pathStr.size()));
+	return cacheDirectory / filename;
+}
+
+SerializationResult AssetSerialization::LoadCachedAsset(const std::filesystem::path& cachePath, const AssetSource& source, u64& outId, std::vector<u8>& outData) {
+	FILE* pFile = fopen(cachePath.string().c_str(), "rb");
+	if (!pFile) {
+		return SERIALIZATION_FILE_NOT_FOUND;
+	}
+
+	AssetCacheHeader header{};
+	if (fread(&header, sizeof(AssetCacheHeader), 1, pFile) != 1 ||
+		memcmp(header.signature, ASSET_CACHE_SIGNATURE, sizeof(ASSET_CACHE_SIGNATURE)) != 0 ||
+		header.serializerVersion != ASSET_SERIALIZER_VERSION ||
+		header.type != source.type) {
+		fclose(pFile);
+		return SERIALIZATION_INVALID_ASSET_DATA;
+	}
+
+	// Files that were touched without being changed, e.g. by checking them out again, only cost a hash
+	AssetSourceStamp stamp;
+	u64 sourceHash;
+	if (!GetAssetSourceStamp(source.path, stamp)) {
+		fclose(pFile);
+		return SERIALIZATION_FILE_NOT_FOUND;
+	}
+	const bool stampChanged = stamp != header.stamp;
+	if (stampChanged && (!HashAssetSource(source.path, sourceHash) || sourceHash != header.sourceHash)) {
+		fclose(pFile);
+		return SERIALIZATION_INVALID_ASSET_DATA;
+	}
+
+	outData.resize(header.size);
+	const bool read = fread(outData.data(), 1, header.size, pFile) == header.size;
+	fclose(pFile);
+
+	// Catches entries left truncated by an interrupted write
+	if (!read || AssetArchive::ComputeChecksum(outData.data(), outData.size()) != header.checksum) {
+		outData.clear();
+		return SERIALIZATION_INVALID_ASSET_DATA;
+	}
+
+	if (stampChanged) {
+		header.stamp = stamp;
+		WriteCachedAsset(cachePath, header, outData.data());
+	}
+
+	outId = header.id;
+	return SERIALIZATION_SUCCESS;
+}
+
+SerializationResult AssetSerialization::SaveCachedAsset(const std::filesystem::path& cachePath, const AssetSource& source, u64 id, const std::vector<u8>& data) {
+	AssetCacheHeader header{};
+	memcpy(header.signature, ASSET_CACHE_SIGNATURE, sizeof(ASSET_CACHE_SIGNATURE));
+	header.serializerVersion = ASSET_SERIALIZER_VERSION;
+	header.id = id;
+	header.size = data.size();
+	header.checksum = AssetArchive::ComputeChecksum(data.data(), data.size());
+	header.type = source.type;
+
+	// Stamped before hashing, so a write in between leaves a stale stamp rather than a stale hash
+	if (!GetAssetSourceStamp(source.path, header.stamp) || !HashAssetSource(source.path, header.sourceHash)) {
+		return SERIALIZATION_FAILED_TO_OPEN_FILE;
+	}
+
+	if (!WriteCachedAsset(cachePath, header, data.data())) {
+		return SERIALIZATION_FAILED_TO_OPEN_FILE;
+	}
+	return SERIALIZATION_SUCCESS;
+}
+
+SerializationResult AssetSerialization::LoadAssetCached(const AssetSource& source, const std::filesystem::path& cacheDirectory, u64& outId, std::vector<u8>& outData, bool& outFromCache) {
+	const std::filesystem::path cachePath = GetCachedAssetPath(cacheDirectory, source.path);
+	outFromCache = LoadCachedAsset(cachePath, source, outId, outData) == SERIALIZATION_SUCCESS;
+	if (outFromCache) {
+		return SERIALIZATION_SUCCESS;
+	}
+
+	const SerializationResult result = LoadAsset(source, outId, outData);
+	if (result == SERIALIZATION_SUCCESS) {
+		// A failed cache write only costs a rebuild next time
+		SaveCachedAsset(cachePath, source, outId, outData);
+	}
+	return result;
+}
+#pragma endregion
+
+#pragma region Parallel loading
+SerializationResult AssetSerialization::LoadAsset(const AssetSource& source, u64& outId, std::vector<u8>& outData) {
+	nlohmann::json metadata;
+	if (LoadAssetMetadataFromFile(source.path, metadata) != SERIALIZATION_SUCCESS || !metadata.contains("guid")) {
+		return SERIALIZATION_INVALID_METADATA;
+	}
+	outId = metadata["guid"];
+
+	return LoadAssetFromFile(source.path, source.type, metadata, outData);
+}
+
+void AssetSerialization::FindAssetSources(const std::filesystem::path& directory, std::vector<AssetSource>& outSources) {
+	outSources.clear();
+	for (const auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
+		AssetType assetType;
+		if (entry.is_regular_file() && TryGetAssetTypeFromPath(entry.path(), assetType) == SERIALIZATION_SUCCESS) {
+			outSources.push_back({ entry.path(), assetType, entry.file_size() });
+		}
+	}
+
+	// Directory iteration order is unspecified
+	std::sort(outSources.begin(), outSources.end(), [](const AssetSource& a, const AssetSource& b) {
+		return a.path < b.path;
+	});
+}
+
+void AssetSerialization::LoadAssetsParallel(const std::vector<AssetSource>& sources, const AssetLoadFn& load, const AssetCommitFn& commit) {
+	struct LoadedAsset {
+		SerializationResult result;
+		u64 id;
+		u32 thread;
+		size_t offset;
+		size_t size;
+	};
+
+	// Each thread appends the assets it loads to its own buffer, the results point into them
+	struct LoadThread {
+		std::vector<u8> data;
+		std::vector<u8> scratch;
+	};
+
+	const u32 sourceCount = (u32)sources.size();
+	const u32 hardwareThreads = std::thread::hardware_concurrency();
+	const u32 threadCount = std::max(1u, std::min(hardwareThreads, sourceCount));
+
+	std::vector<LoadedAsset> results(sourceCount);
+	std::vector<LoadThread> threads(threadCount);
+	std::atomic<u32> nextSource = 0;
+
+	auto loadSources = [&](u32 threadIndex) {
+		LoadThread& thread = threads[threadIndex];
+		u32 i;
+		while ((i = nextSource.fetch_add(1, std::memory_order_relaxed)) < sourceCount) {
+			LoadedAsset& loaded = results[i];
+			loaded.id = 0;
+			loaded.thread = threadIndex;
+			loaded.offset = thread.data.size();
+
+			thread.scratch.clear();
+			try {
+				loaded.result = load(sources[i], loaded.id, thread.scratch);
+			}
+			catch (const std::exception&) {
+				loaded.result = SERIALIZATION_INVALID_ASSET_DATA;
+			}
+
+			loaded.size = loaded.result == SERIALIZATION_SUCCESS ? thread.scratch.size() : 0;
+			thread.data.insert(thread.data.end(), thread.scratch.begin(), thread.scratch.begin() + loaded.size);
+		}
+	};
+
+	// The calling thread loads too
+	std::vector<std::thread> workers;
+	for (u32 i = 1; i < threadCount; i++) {
+		workers.emplace_back(loadSources, i);
+	}
+	loadSources(0);
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	for (u32 i = 0; i < sourceCount; i++) {
+		const LoadedAsset& loaded = results[i];
+		commit(sources[i], loaded.result, loaded.id, threads[loaded.thread].data.data() + loaded.offset, loaded.size);
+	}
+}
+#pragma endregion
@@ -2,6 +2,8 @@
 #include <nlohmann/json.hpp>
 #include <filesystem>
 #include <string>
+#include <vector>
+#include <functional>
 #include "typedef.h"
 #include "asset_types.h"
 
@@ -20,6 +22,17 @@ enum SerializationResult {
 };
 
 namespace AssetSerialization {
+	struct AssetSource {
+		std::filesystem::path path;
+		AssetType type;
+		size_t fileSize;
+	};
+
+	// Loads the asset and its id from the metadata, called from worker threads
+	typedef std::function<SerializationResult(const AssetSource& source, u64& outId, std::vector<u8>& outData)> AssetLoadFn;
+	// Called on the loading thread, one source at a time in order
+	typedef std::function<void(const AssetSource& source, SerializationResult result, u64 id, const u8* pData, size_t size)> AssetCommitFn;
+
 	SerializationResult TryGetAssetTypeFromPath(const std::filesystem::path& path, AssetType& outType);
 	bool HasMetadata(const std::filesystem::path& path);
 	std::filesystem::path GetAssetMetadataPath(const std::filesystem::path& path);
@@ -31,4 +44,23 @@ namespace AssetSerialization {
 
 	SerializationResult LoadAssetFromFile(const std::filesystem::path& path, AssetType type, const nlohmann::json& metadata, std::vector<u8>& outData);
 	SerializationResult SaveAssetToFile(const std::filesystem::path& path, AssetType type, nlohmann::json& metadata, const void* pData);
+	// Metadata and asset data, returns SERIALIZATION_INVALID_METADATA if the metadata couldn't be loaded
+	SerializationResult LoadAsset(const AssetSource& source, u64& outId, std::vector<u8>& outData);
+
+	// Asset source files under a directory, sorted by path so they are always added in the same order
+	void FindAssetSources(const std::filesystem::path& directory, std::vector<AssetSource>& outSources);
+	// Runs load for every source on a pool of threads, then commit for each source in order on the calling thread
+	void LoadAssetsParallel(const std::vector<AssetSource>& sources, const AssetLoadFn& load, const AssetCommitFn& commit);
+
+	// Serialized assets can be cached so unchanged sources don't have to be parsed again. A cache entry is stored per source
+	// and used while the serializer version matches and the source and metadata are unchanged. File stamps are compared first,
+	// the contents are only hashed if the stamps differ
+	std::filesystem::path GetCachedAssetPath(const std::filesystem::path& cacheDirectory, const std::filesystem::path& sourcePath);
+	SerializationResult LoadCachedAsset(const std::filesystem::path& cachePath, const AssetSource& source, u64& outId, std::vector<u8>& outData);
+	SerializationResult SaveCachedAsset(const std::filesystem::path& cachePath, const AssetSource& source, u64 id, const std::vector<u8>& data);
+	// Loads from the cache if the source is unchanged, otherwise loads the source and caches the result
+	SerializationResult LoadAssetCached(const AssetSource& source, const std::filesystem::path& cacheDirectory, u64& outId, std::vector<u8>& outData, bool& outFromCache);
+
+	// Writes the ids of the assets directly referenced by the asset data, matches AssetDependencyFn
+	u32 GetAssetDependencies(AssetType type, const void* pData, u64* pOutIds, u32 maxCount);
 }
\ No newline at end of file
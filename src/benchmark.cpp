@@ -0,0 +1,163 @@
+#include "benchmark.h"
+#include "actors.h"
+#include "particles.h"
+#include "game.h"
+#include "game_state.h"
+#include "game_rendering.h"
+#include "asset_manager.h"
+#include "random.h"
+#include "memory_arena.h"
+#include <cstdio>
+#include <chrono>
+
+constexpr u64 BENCHMARK_RANDOM_SEED = 0x6e656b726f;
+
+struct StressScenario {
+	const char* name;
+	u32 typeMask;
+};
+
+#define ACTOR_TYPE_BIT(TYPE) (1u << (TYPE))
+
+constexpr StressScenario scenarios[] = {
+	{ "mixed", ACTOR_TYPE_BIT(ACTOR_TYPE_BULLET) | ACTOR_TYPE_BIT(ACTOR_TYPE_ENEMY) | ACTOR_TYPE_BIT(ACTOR_TYPE_PICKUP) | ACTOR_TYPE_BIT(ACTOR_TYPE_EFFECT) },
+	{ "enemies", ACTOR_TYPE_BIT(ACTOR_TYPE_ENEMY) },
+	{ "bullets", ACTOR_TYPE_BIT(ACTOR_TYPE_BULLET) },
+};
+constexpr u32 actorCounts[] = { 64, 128, 256, MAX_DYNAMIC_ACTOR_COUNT };
+
+constexpr const char* dispatchModeNames[] = { "pool", "batched" };
+
+constexpr u32 MAX_STRESS_PROTOTYPES = 1024;
+
+static u32 CollectPrototypes(u32 typeMask, ActorPrototypeHandle* pOutHandles) {
+	u32 idCount = 0;
+	const u64* pIds = AssetManager::GetAssetIdsByType(ASSET_TYPE_ACTOR_PROTOTYPE, idCount);
+
+	u32 count = 0;
+	for (u32 i = 0; i < idCount && count < MAX_STRESS_PROTOTYPES; i++) {
+		const ActorPrototypeHandle handle(pIds[i]);
+		const ActorPrototype* pPrototype = AssetManager::GetAsset(handle);
+		if (!pPrototype || !(typeMask & ACTOR_TYPE_BIT(pPrototype->type))) {
+			continue;
+		}
+
+		pOutHandles[count++] = handle;
+	}
+
+	return count;
+}
+
+// Returns the number of actors spawned, which is less than targetCount if the pool runs out
+static u32 SpawnStressActors(const ActorPrototypeHandle* pHandles, u32 handleCount, u32 targetCount) {
+	Game::ClearActors();
+	Game::ClearParticles();
+
+	const glm::vec2 playAreaSize = Game::GetCurrentPlayAreaSize();
+	const glm::vec2 center = playAreaSize * 0.5f;
+
+	u32 spawned = 0;
+	// The player is spawned first since most actors query it
+	if (Game::SpawnActor(Game::GetConfig().playerPrototypeHandle, center)) {
+		spawned++;
+	}
+
+	for (u32 i = 0; spawned < targetCount; i++) {
+		const glm::vec2 position = { Random::GenerateReal(1.0f, playAreaSize.x - 1.0f), Random::GenerateReal(1.0f, playAreaSize.y - 1.0f) };
+		const glm::vec2 velocity = Random::GenerateDirection() * 0.0625f;
+		if (!Game::SpawnActor(pHandles[i % handleCount], position, velocity)) {
+			break;
+		}
+		spawned++;
+	}
+
+	Game::Rendering::SetViewportPos(center - glm::vec2(VIEWPORT_WIDTH_METATILES, VIEWPORT_HEIGHT_METATILES) * 0.5f, false);
+	return spawned;
+}
+
+static void RunScenario(const StressScenario& scenario, const ActorPrototypeHandle* pHandles, u32 handleCount, u32 targetCount, u32 frameCount) {
+	Random::Seed(BENCHMARK_RANDOM_SEED);
+	const u32 spawned = SpawnStressActors(pHandles, handleCount, targetCount);
+
+	Game::ResetActorProfileTimes();
+	u32 minActorCount = spawned;
+
+	const auto start = std::chrono::steady_clock::now();
+	for (u32 i = 0; i < frameCount; i++) {
+		// Normally done by StepFrame
+		ArenaAllocator::Clear(ARENA_PER_FRAME);
+
+		Game::UpdateActors();
+		Game::UpdateParticles();
+		Game::Rendering::ClearSpriteLayers();
+		Game::DrawActors();
+		Game::DrawParticles();
+
+		// Normally done by the main loop
+		AssetManager::EndFrame();
+
+		const u32 actorCount = Game::GetActors()->Count();
+		if (actorCount < minActorCount) {
+			minActorCount = actorCount;
+		}
+	}
+	const std::chrono::duration<r64> elapsed = std::chrono::steady_clock::now() - start;
+
+	const ActorProfileTimes& times = Game::GetActorProfileTimes();
+	const r64 msPerFrame = 1000.0 / frameCount;
+	const r64 queries = times.seconds[ACTOR_PROFILE_QUERIES] * msPerFrame;
+	const r64 sweeps = times.seconds[ACTOR_PROFILE_TILE_SWEEPS] * msPerFrame;
+	const r64 update = times.seconds[ACTOR_PROFILE_UPDATE] * msPerFrame - queries - sweeps;
+	const r64 sprites = times.seconds[ACTOR_PROFILE_SPRITES] * msPerFrame;
+
+	printf("%-8s %-8s %4u/%-4u %4u %9.4f %9.4f %9.4f %9.4f %9.4f %8u\n",
+		scenario.name,
+		dispatchModeNames[Game::GetActorDispatchMode()],
+		spawned,
+		targetCount,
+		minActorCount,
+		elapsed.count() * msPerFrame,
+		update,
+		queries,
+		sweeps,
+		sprites,
+		times.calls[ACTOR_PROFILE_QUERIES] / frameCount);
+}
+
+void Benchmark::RunActorStress(u32 frameCount) {
+	if (frameCount == 0) {
+		return;
+	}
+
+	static ActorPrototypeHandle handles[MAX_STRESS_PROTOTYPES];
+
+	// Measure every actor, not just the ones near the viewport
+	const glm::vec2 oldActivationMargin = Game::GetActorActivationMargin();
+	const ActorDispatchMode oldDispatchMode = Game::GetActorDispatchMode();
+	Game::SetActorActivationMargin(Game::GetCurrentPlayAreaSize());
+	Game::SetActorProfilingEnabled(true);
+
+	printf("Actor stress benchmark, %u frames per run, times in ms per frame\n", frameCount);
+	printf("%-8s %-8s %9s %4s %9s %9s %9s %9s %9s %8s\n", "scenario", "dispatch", "spawned", "min", "total", "update", "queries", "sweeps", "sprites", "queries/f");
+
+	for (const StressScenario& scenario : scenarios) {
+		const u32 handleCount = CollectPrototypes(scenario.typeMask, handles);
+		if (handleCount == 0) {
+			printf("%-8s no matching actor prototypes, skipping\n", scenario.name);
+			continue;
+		}
+
+		for (u32 dispatchMode = ACTOR_DISPATCH_POOL_ORDER; dispatchMode <= ACTOR_DISPATCH_BATCHED; dispatchMode++) {
+			Game::SetActorDispatchMode((ActorDispatchMode)dispatchMode);
+			for (u32 targetCount : actorCounts) {
+				RunScenario(scenario, handles, handleCount, targetCount, frameCount);
+			}
+		}
+	}
+
+	Game::SetActorProfilingEnabled(false);
+	Game::SetActorDispatchMode(oldDispatchMode);
+	Game::SetActorActivationMargin(oldActivationMargin);
+	Game::ClearActors();
+	Game::ClearParticles();
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include "typedef.h"
+
+namespace Benchmark {
+	// Headless actor and collision stress test. Expects assets to be loaded and the game initialized
+	void RunActorStress(u32 frameCount);
+}
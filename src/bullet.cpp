@@ -2,10 +2,11 @@
 #include "game_rendering.h"
 #include "game_state.h"
 #include "random.h"
+#include "particles.h"
 
 static void BulletDie(Actor* pBullet, const glm::vec2& effectPos) {
     pBullet->flags.pendingRemoval = true;
-    Game::SpawnActor(pBullet->data.bullet.deathEffect, effectPos);
+    Game::SpawnEffect(pBullet->data.bullet.deathEffect, effectPos);
 }
 
 static void HandleBulletEnemyCollision(Actor* pBullet, Actor* pEnemy) {
@@ -98,4 +99,9 @@ constexpr ActorUpdateFn Game::bulletUpdateTable[BULLET_TYPE_COUNT] = {
 constexpr ActorDrawFn Game::bulletDrawTable[BULLET_TYPE_COUNT] = {
     Game::DrawActorDefault,
     Game::DrawActorDefault,
+};
+
+constexpr ActorBatchUpdateFn Game::bulletBatchUpdateTable[BULLET_TYPE_COUNT] = {
+    Game::UpdateActorBatch<UpdateDefaultBullet>,
+    Game::UpdateActorBatch<UpdateGrenade>,
 };
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "compression.h"
+#include <cstring>
+
+static constexpr u32 MIN_MATCH = 4;
+// The format requires the last bytes to be literals and the last match to start a bit before the end
+static constexpr u32 LAST_LITERALS = 5;
+static constexpr u32 MATCH_FIND_LIMIT = 12;
+static constexpr u32 MAX_OFFSET = 65535;
+static constexpr u32 HASH_BITS = 12;
+
+static inline u32 Read32(const u8* p) {
+	u32 result;
+	memcpy(&result, p, sizeof(u32));
+	return result;
+}
+
+static inline u32 HashSequence(u32 sequence) {
+	return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Lengths that don't fit in the token nibble continue in bytes of 255
+static inline u8* WriteLength(u8* op, size_t length) {
+	while (length >= 255) {
+		*op++ = 255;
+		length -= 255;
+	}
+	*op++ = (u8)length;
+	return op;
+}
+
+static u8* WriteSequence(u8* op, const u8* oend, const u8* pLiterals, size_t literalLength, u32 offset, size_t matchLength) {
+	// Token, literals, their length bytes, offset and match length bytes
+	const size_t worstCase = 1 + literalLength + literalLength / 255 + 1 + 2 + matchLength / 255 + 1;
+	if (worstCase > (size_t)(oend - op)) {
+		return nullptr;
+	}
+
+	u8* pToken = op++;
+	*pToken = (u8)((literalLength < 15 ? literalLength : 15) << 4);
+	if (literalLength >= 15) {
+		op = WriteLength(op, literalLength - 15);
+	}
+	if (literalLength > 0) {
+		memcpy(op, pLiterals, literalLength);
+		op += literalLength;
+	}
+
+	if (matchLength == 0) {
+		return op; // Last sequence
+	}
+
+	*op++ = (u8)(offset & 0xFF);
+	*op++ = (u8)(offset >> 8);
+
+	const size_t encodedMatchLength = matchLength - MIN_MATCH;
+	*pToken |= (u8)(encodedMatchLength < 15 ? encodedMatchLength : 15);
+	if (encodedMatchLength >= 15) {
+		op = WriteLength(op, encodedMatchLength - 15);
+	}
+	return op;
+}
+
+size_t Compression::Compress(const void* pSrc, size_t srcSize, void* pDst, size_t dstCapacity) {
+	const u8* const src = (const u8*)pSrc;
+	const u8* const iend = src + srcSize;
+	u8* const dst = (u8*)pDst;
+	u8* op = dst;
+	const u8* const oend = dst + dstCapacity;
+
+	const u8* ip = src;
+	const u8* anchor = src;
+
+	if (srcSize > MATCH_FIND_LIMIT) {
+		const u8* const matchFindLimit = iend - MATCH_FIND_LIMIT;
+		const u8* const matchLimit = iend - LAST_LITERALS;
+
+		// Positions relative to src, stale or empty slots are caught by comparing the bytes
+		u32 table[1 << HASH_BITS] = {};
+
+		while (ip < matchFindLimit) {
+			const u32 sequence = Read32(ip);
+			const u32 hash = HashSequence(sequence);
+			const u8* pRef = src + table[hash];
+			table[hash] = (u32)(ip - src);
+
+			if (pRef >= ip || ip - pRef > MAX_OFFSET || Read32(pRef) != sequence) {
+				ip++;
+				continue;
+			}
+
+			// Extend backwards into the pending literals
+			while (ip > anchor && pRef > src && ip[-1] == pRef[-1]) {
+				ip--;
+				pRef--;
+			}
+
+			const u8* pMatchEnd = ip + MIN_MATCH;
+			const u8* pRefEnd = pRef + MIN_MATCH;
+			while (pMatchEnd < matchLimit && *pMatchEnd == *pRefEnd) {
+				pMatchEnd++;
+				pRefEnd++;
+			}
+
+			op = WriteSequence(op, oend, anchor, ip - anchor, (u32)(ip - pRef), pMatchEnd - ip);
+			if (!op) {
+				return 0;
+			}
+
+			ip = pMatchEnd;
+			anchor = ip;
+
+			// Index a position inside the match too, which helps with runs
+			if (ip < matchFindLimit) {
+				table[HashSequence(Read32(ip - 2))] = (u32)(ip - 2 - src);
+			}
+		}
+	}
+
+	op = WriteSequence(op, oend, anchor, iend - anchor, 0, 0);
+	if (!op) {
+		return 0;
+	}
+
+	return op - dst;
+}
+
+bool Compression::Decompress(const void* pSrc, size_t srcSize, void* pDst, size_t dstSize) {
+	const u8* ip = (const u8*)pSrc;
+	const u8* const iend = ip + srcSize;
+	u8* const dst = (u8*)pDst;
+	u8* op = dst;
+	u8* const oend = dst + dstSize;
+
+	while (ip < iend) {
+		const u8 token = *ip++;
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15) {
+			u8 b;
+			do {
+				if (ip >= iend) {
+					return false;
+				}
+				b = *ip++;
+				literalLength += b;
+			} while (b == 255);
+		}
+
+		if (literalLength > (size_t)(iend - ip) || literalLength > (size_t)(oend - op)) {
+			return false;
+		}
+		if (literalLength > 0) {
+			memcpy(op, ip, literalLength);
+			ip += literalLength;
+			op += literalLength;
+		}
+
+		if (ip == iend) {
+			break; // Last sequence has no match
+		}
+
+		if (iend - ip < 2) {
+			return false;
+		}
+		const size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (size_t)(op - dst)) {
+			return false;
+		}
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15) {
+			u8 b;
+			do {
+				if (ip >= iend) {
+					return false;
+				}
+				b = *ip++;
+				matchLength += b;
+			} while (b == 255);
+		}
+		matchLength += MIN_MATCH;
+
+		if (matchLength > (size_t)(oend - op)) {
+			return false;
+		}
+
+		const u8* pMatch = op - offset;
+		if (offset >= matchLength) {
+			memcpy(op, pMatch, matchLength);
+			op += matchLength;
+		}
+		else {
+			// Overlapping copy repeats the last offset bytes
+			for (size_t i = 0; i < matchLength; i++) {
+				*op++ = *pMatch++;
+			}
+		}
+	}
+
+	return op == oend;
+}
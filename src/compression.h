@@ -0,0 +1,15 @@
+#pragma once
+#include "typedef.h"
+
+// LZ4 block format compression. Self-contained so the asset packer can use it without the engine
+namespace Compression {
+	// Worst case size of incompressible input
+	constexpr size_t GetMaxCompressedSize(size_t size) {
+		return size + size / 255 + 16;
+	}
+
+	// Returns the compressed size, or 0 if the output didn't fit
+	size_t Compress(const void* pSrc, size_t srcSize, void* pDst, size_t dstCapacity);
+	// Fails on malformed input or if the output isn't exactly dstSize bytes
+	bool Decompress(const void* pSrc, size_t srcSize, void* pDst, size_t dstSize);
+}
@@ -335,6 +335,30 @@ struct RoomTemplate {
 		return (RoomActor*)((u8*)this + actorOffset);
 	}
 };
+
+struct RoomTemplateLayout {
+	u32 mapTileOffset;
+	u32 tilesOffset;
+	u32 actorOffset;
+	u32 size;
+};
+
+// Rooms only store the screens they cover. The header is followed by the map tiles and tiles, both in rows
+// as wide as the room, and the actors
+constexpr RoomTemplateLayout GetRoomTemplateLayout(u32 width, u32 height, u32 actorCount) {
+	const u32 screenCount = width * height;
+	const u32 mapTileOffset = sizeof(RoomTemplate);
+	const u32 tilesOffset = mapTileOffset + screenCount * 2 * sizeof(BgTile);
+	const u32 tilesEnd = tilesOffset + screenCount * ROOM_SCREEN_TILE_COUNT;
+	const u32 actorOffset = (tilesEnd + alignof(RoomActor) - 1) & ~u32(alignof(RoomActor) - 1);
+
+	return {
+		.mapTileOffset = mapTileOffset,
+		.tilesOffset = tilesOffset,
+		.actorOffset = actorOffset,
+		.size = u32(actorOffset + actorCount * sizeof(RoomActor)),
+	};
+}
 #pragma endregion
 
 #pragma region Overworld
@@ -15,7 +15,7 @@ void Game::StepCoroutines() {
 
     for (u32 i = 0; i < coroutines.Count(); i++) {
         PoolHandle<Coroutine> handle = coroutines.GetHandle(i);
-        Coroutine* pCoroutine = coroutines.Get(handle);
+        Coroutine* pCoroutine = &coroutines.GetDense(i);
 
         if (!StepCoroutine(pCoroutine)) {
             coroutineRemoveList.Add(handle);
@@ -26,8 +26,7 @@ void Game::StepCoroutines() {
         }
     }
 
-    for (u32 i = 0; i < coroutineRemoveList.Count(); i++) {
-        auto handle = *coroutineRemoveList.Get(coroutineRemoveList.GetHandle(i));
+    for (const PoolHandle<Coroutine>& handle : coroutineRemoveList) {
         coroutines.Remove(handle);
     }
 }
@@ -573,7 +573,15 @@ static void DrawTilemap(const Tilemap* pTilemap, const ImVec2& metatileOffset, c
 		return;
 	}
 
-	const u32 tileCount = metatileSize.x * metatileSize.y * METATILE_TILE_COUNT;
+	const u32 xOffsetInt = u32(metatileOffset.x);
+	const u32 yOffsetInt = u32(metatileOffset.y);
+	const r32 xOffsetRemainder = metatileOffset.x - xOffsetInt;
+	const r32 yOffsetRemainder = metatileOffset.y - yOffsetInt;
+
+	// Rooms are only as large as their screens, so the view can extend past the tilemap
+	const u32 width = xOffsetInt < pTilemap->width ? glm::min(u32(metatileSize.x), pTilemap->width - xOffsetInt) : 0;
+	const u32 height = yOffsetInt < pTilemap->height ? glm::min(u32(metatileSize.y), pTilemap->height - yOffsetInt) : 0;
+	const u32 tileCount = width * height * METATILE_TILE_COUNT;
 
 	drawList->PushTextureID(textureId);
 	drawList->PrimReserve(tileCount * 6, tileCount * 4); // NOTE: Seems as if primitives for max. 4096 tiles can be reserved...
@@ -581,13 +589,8 @@ static void DrawTilemap(const Tilemap* pTilemap, const ImVec2& metatileOffset, c
 	ImVec2 verts[METATILE_TILE_COUNT * 4];
 	ImVec2 uv[METATILE_TILE_COUNT * 4];
 
-	const u32 xOffsetInt = u32(metatileOffset.x);
-	const u32 yOffsetInt = u32(metatileOffset.y);
-	const r32 xOffsetRemainder = metatileOffset.x - xOffsetInt;
-	const r32 yOffsetRemainder = metatileOffset.y - yOffsetInt;
-
-	for (u32 y = 0; y < metatileSize.y; y++) {
-		for (u32 x = 0; x < metatileSize.x; x++) {
+	for (u32 y = 0; y < height; y++) {
+		for (u32 x = 0; x < width; x++) {
 			const u32 i = (x + xOffsetInt) + (y + yOffsetInt) * pTilemap->width;
 			const u8 tilesetTileIndex = pTilemap->GetTileData()[i];
 			const TilesetTile& tilesetTile = pTileset->tiles[tilesetTileIndex];
@@ -1077,6 +1080,9 @@ static bool ResizeEditedAsset(EditedAsset& asset, size_t newSize) {
 
 static bool SaveAssetToFile(AssetType type, const std::filesystem::path& relativePath, const void* pData, u64 id = UUID_NULL) {
 	std::filesystem::path fullPath = std::filesystem::path(ASSETS_SRC_DIR) / relativePath;
+	if (!std::filesystem::exists(fullPath)) {
+		Editor::Assets::InvalidateDirectoryTree();
+	}
 
 	nlohmann::json metadata;
 	if (!AssetSerialization::HasMetadata(fullPath)) {
@@ -1129,6 +1135,7 @@ static bool SaveEditedAsset(EditedAsset& asset, ApplyAssetEditorDataFn applyFn)
 
 	void* data = AssetManager::GetAsset(asset.id, pAssetInfo->flags.type);
 	memcpy(data, asset.data, asset.size);
+	AssetManager::MarkAssetsModified();
 
 	asset.dirty = false;
 	return true;
@@ -1228,6 +1235,7 @@ static bool DeleteAssetSourceFiles(const AssetEntry* pAssetInfo) {
 		DEBUG_WARN("Asset metadata file does not exist: %s\n", metaFilePath.string().c_str());
 	}
 
+	Editor::Assets::InvalidateDirectoryTree();
 	return result;
 }
 
@@ -1325,35 +1333,9 @@ static bool DrawAssetFieldN(const char* label, AssetType type, u64* pSelectedIds
 	return valueChanged;
 }
 
-// TODO: This result could be cached, but using the naive approach for now
-static bool DirectoryHasAssetsOfType(const std::filesystem::path& dir, AssetType type) {
-	for (const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
-		if (entry.is_regular_file() && entry.path().extension() == ASSET_TYPE_FILE_EXTENSIONS[type]) {
-			return true;
-		}
-	}
-	return false;
-}
-
-static std::vector<AssetEntry*> CollectAssetsInDirectory(const std::filesystem::path& dir) {
-	std::vector<AssetEntry*> assets;
-
-	for (const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
-		if (!entry.is_regular_file() || entry.path().extension() == ".meta") {
-			continue;
-		}
-		std::filesystem::path relativePath = std::filesystem::relative(entry.path(), ASSETS_SRC_DIR);
-		AssetEntry* pAssetInfo = AssetManager::GetAssetInfoFromPath(relativePath);
-		if (pAssetInfo&& !pAssetInfo->flags.deleted) {
-			assets.push_back(pAssetInfo);
-		}
-	}
-
-	return assets;
-}
-
 static void UpdateAssetPathsWithNewDirectory(const std::filesystem::path& oldDirPath, const std::filesystem::path& newDirPath) {
-	std::vector<AssetEntry*> assets = CollectAssetsInDirectory(oldDirPath);
+	std::vector<AssetEntry*> assets;
+	Editor::Assets::CollectAssetsInDirectory(oldDirPath, assets);
 
 	std::filesystem::path oldRelativePath = std::filesystem::relative(oldDirPath, ASSETS_SRC_DIR);
 	std::filesystem::path newRelativePath = std::filesystem::relative(newDirPath, ASSETS_SRC_DIR);
@@ -1367,7 +1349,7 @@ static void UpdateAssetPathsWithNewDirectory(const std::filesystem::path& oldDir
 		// Update the asset's relative path
 		std::string newPathStr = newAssetPath.string();
 		if (newPathStr.length() < MAX_ASSET_PATH_LENGTH) {
-			strcpy(pAssetInfo->relativePath, newPathStr.c_str());
+			AssetManager::RenameAsset(pAssetInfo->id, newPathStr.c_str());
 			DEBUG_LOG("Updated asset path from '%s' to '%s'\n", oldAssetPath.string().c_str(), newAssetPath.string().c_str());
 		} else {
 			DEBUG_ERROR("New asset path '%s' exceeds maximum length (%d characters)\n", newPathStr.c_str(), MAX_ASSET_PATH_LENGTH);
@@ -1432,10 +1414,10 @@ static bool MoveAssetToDirectory(u64 assetId, const std::filesystem::path& targe
 		DEBUG_LOG("Moved asset metadata file from '%s' to '%s'\n", currentMetaPath.string().c_str(), newMetaPath.string().c_str());
 	}
 
-	// Update the asset's relative path in memory (non-const cast needed for modification)
-	AssetEntry* pMutableAssetInfo = AssetManager::GetAssetInfo(assetId);
-	if (pMutableAssetInfo) {
-		strcpy(pMutableAssetInfo->relativePath, newPathStr.c_str());
+	Editor::Assets::InvalidateDirectoryTree();
+
+	// Update the asset's relative path in memory
+	if (AssetManager::RenameAsset(assetId, newPathStr.c_str())) {
 		DEBUG_LOG("Updated asset relative path to '%s'\n", newPathStr.c_str());
 	}
 
@@ -1445,132 +1427,134 @@ static bool MoveAssetToDirectory(u64 assetId, const std::filesystem::path& targe
 static u64 DrawAssetHierarchyRecursive(AssetType type, AssetListActionState* pActionState, const std::filesystem::path& dir = ASSETS_SRC_DIR) {
 	u64 result = UUID_NULL;
 
-	for (const auto& entry : std::filesystem::directory_iterator(dir)) {
-		if (entry.is_directory()) {
-			ImVec4 folderColor = ImGui::GetStyleColorVec4(ImGuiCol_Text);
-			if (!DirectoryHasAssetsOfType(entry.path(), type)) {
-				folderColor = ImVec4(0.5f, 0.5f, 0.5f, 1.0f); // Dim color for empty folders
-			}
+	const Editor::Assets::AssetDirectory* pDirectory = Editor::Assets::GetDirectory(dir);
+	if (!pDirectory) {
+		return result;
+	}
 
-			ImGui::PushID(entry.path().filename().string().c_str());
-			ImGui::PushStyleColor(ImGuiCol_Text, folderColor);
-			bool nodeOpen = ImGui::TreeNode(entry.path().filename().string().c_str());
-			ImGui::PopStyleColor();
+	for (u32 subdirectory : pDirectory->subdirectories) {
+		const Editor::Assets::AssetDirectory* pSubdirectory = Editor::Assets::GetDirectory(subdirectory);
+		const std::filesystem::path& dirPath = pSubdirectory->path;
+		ImVec4 folderColor = ImGui::GetStyleColorVec4(ImGuiCol_Text);
+		if (!(pSubdirectory->assetTypeMask & (1 << type))) {
+			folderColor = ImVec4(0.5f, 0.5f, 0.5f, 1.0f); // Dim color for empty folders
+		}
+
+		ImGui::PushID(dirPath.filename().string().c_str());
+		ImGui::PushStyleColor(ImGuiCol_Text, folderColor);
+		bool nodeOpen = ImGui::TreeNode(dirPath.filename().string().c_str());
+		ImGui::PopStyleColor();
 
-			if (pActionState) {
-				if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Right)) {
-					ImGui::OpenPopup("FolderPopup");
+		if (pActionState) {
+			if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Right)) {
+				ImGui::OpenPopup("FolderPopup");
+			}
+			if (ImGui::BeginPopup("FolderPopup")) {
+				if (ImGui::MenuItem("Rename folder")) {
+					pActionState->actionStarted = true;
+					pActionState->actionType = ASSET_LIST_ACTION_RENAME;
+					pActionState->targetPath = dirPath;
 				}
-				if (ImGui::BeginPopup("FolderPopup")) {
-					if (ImGui::MenuItem("Rename folder")) {
-						pActionState->actionStarted = true;
-						pActionState->actionType = ASSET_LIST_ACTION_RENAME;
-						pActionState->targetPath = entry.path();
-					}
-					if (ImGui::MenuItem("Delete folder")) {
-						pActionState->actionStarted = true;
-						pActionState->actionType = ASSET_LIST_ACTION_DELETE;
-						pActionState->targetPath = entry.path();
-					}
-					if (ImGui::MenuItem("New asset")) {
-						pActionState->actionStarted = true;
-						pActionState->actionType = ASSET_LIST_ACTION_NEW_ASSET;
-						pActionState->targetPath = entry.path();
-					}
-					if (ImGui::MenuItem("New subfolder")) {
-						pActionState->actionStarted = true;
-						pActionState->actionType = ASSET_LIST_ACTION_NEW_FOLDER;
-						pActionState->targetPath = entry.path();
-					}
-					ImGui::EndPopup();
+				if (ImGui::MenuItem("Delete folder")) {
+					pActionState->actionStarted = true;
+					pActionState->actionType = ASSET_LIST_ACTION_DELETE;
+					pActionState->targetPath = dirPath;
+				}
+				if (ImGui::MenuItem("New asset")) {
+					pActionState->actionStarted = true;
+					pActionState->actionType = ASSET_LIST_ACTION_NEW_ASSET;
+					pActionState->targetPath = dirPath;
 				}
+				if (ImGui::MenuItem("New subfolder")) {
+					pActionState->actionStarted = true;
+					pActionState->actionType = ASSET_LIST_ACTION_NEW_FOLDER;
+					pActionState->targetPath = dirPath;
+				}
+				ImGui::EndPopup();
 			}
+		}
 
-			// Add drag & drop target for moving assets to this directory
-			if (ImGui::BeginDragDropTarget()) {
-				if (const ImGuiPayload* payload = ImGui::AcceptDragDropPayload("dd_asset", ImGuiDragDropFlags_AcceptBeforeDelivery)) {
-					const u64 draggedAssetId = *(const u64*)payload->Data;
-					const AssetEntry* pAssetInfo = AssetManager::GetAssetInfo(draggedAssetId);
-					const bool isValidAsset = pAssetInfo && !pAssetInfo->flags.deleted;
-					
-					if (isValidAsset && payload->IsDelivery()) {
-						if (MoveAssetToDirectory(draggedAssetId, entry.path())) {
-							DEBUG_LOG("Successfully moved asset %llu to directory '%s'\n", draggedAssetId, entry.path().string().c_str());
-						}
+		// Add drag & drop target for moving assets to this directory
+		if (ImGui::BeginDragDropTarget()) {
+			if (const ImGuiPayload* payload = ImGui::AcceptDragDropPayload("dd_asset", ImGuiDragDropFlags_AcceptBeforeDelivery)) {
+				const u64 draggedAssetId = *(const u64*)payload->Data;
+				const AssetEntry* pAssetInfo = AssetManager::GetAssetInfo(draggedAssetId);
+				const bool isValidAsset = pAssetInfo && !pAssetInfo->flags.deleted;
+				
+				if (isValidAsset && payload->IsDelivery()) {
+					if (MoveAssetToDirectory(draggedAssetId, dirPath)) {
+						DEBUG_LOG("Successfully moved asset %llu to directory '%s'\n", draggedAssetId, dirPath.string().c_str());
 					}
 				}
-				ImGui::EndDragDropTarget();
 			}
+			ImGui::EndDragDropTarget();
+		}
 
-			if (nodeOpen) {
-				u64 selectedId = DrawAssetHierarchyRecursive(type, pActionState, entry.path());
-				if (selectedId != UUID_NULL) {
-					result = selectedId;
-				}
-				ImGui::TreePop();
+		if (nodeOpen) {
+			u64 selectedId = DrawAssetHierarchyRecursive(type, pActionState, dirPath);
+			if (selectedId != UUID_NULL) {
+				result = selectedId;
 			}
-			ImGui::PopID();
+			ImGui::TreePop();
 		}
-		else {
-			const std::filesystem::path relativePath = std::filesystem::relative(entry.path(), ASSETS_SRC_DIR);
-			// Ignore .meta files
-			if (relativePath.extension() == ".meta") {
-				continue;
-			}
-			const AssetEntry* pAssetInfo = AssetManager::GetAssetInfoFromPath(relativePath);
-			if (!pAssetInfo || pAssetInfo->flags.type != type) {
-				continue; // Skip assets that are not of the specified type
-			}
+		ImGui::PopID();
+	}
 
-			if (pAssetInfo->flags.deleted) {
-				// TODO: If an asset is marked deleted but the source file exists, we should probably delete the source file
-				DEBUG_WARN("Asset %llu is deleted, skipping\n", pAssetInfo->id);
-				continue;
-			}
+	for (const std::filesystem::path& filePath : pDirectory->files) {
+		const std::filesystem::path relativePath = std::filesystem::relative(filePath, ASSETS_SRC_DIR);
+		const AssetEntry* pAssetInfo = AssetManager::GetAssetInfoFromPath(relativePath);
+		if (!pAssetInfo || pAssetInfo->flags.type != type) {
+			continue; // Skip assets that are not of the specified type
+		}
 
-			ImGui::PushID(pAssetInfo->id);
+		if (pAssetInfo->flags.deleted) {
+			// TODO: If an asset is marked deleted but the source file exists, we should probably delete the source file
+			DEBUG_WARN("Asset %llu is deleted, skipping\n", pAssetInfo->id);
+			continue;
+		}
 
-			std::string assetName = GetAssetName(pAssetInfo->relativePath);
-			ImGui::Selectable(assetName.c_str());
+		ImGui::PushID(pAssetInfo->id);
 
-			if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
-				result = pAssetInfo->id;
-			}
+		std::string assetName = GetAssetName(pAssetInfo->relativePath);
+		ImGui::Selectable(assetName.c_str());
 
-			if (pActionState) {
-				if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Right)) {
-					ImGui::OpenPopup("AssetPopup");
+		if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
+			result = pAssetInfo->id;
+		}
+
+		if (pActionState) {
+			if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Right)) {
+				ImGui::OpenPopup("AssetPopup");
+			}
+			if (ImGui::BeginPopup("AssetPopup")) {
+				if (ImGui::MenuItem("Rename asset")) {
+					pActionState->actionStarted = true;
+					pActionState->actionType = ASSET_LIST_ACTION_RENAME;
+					pActionState->targetPath = filePath;
 				}
-				if (ImGui::BeginPopup("AssetPopup")) {
-					if (ImGui::MenuItem("Rename asset")) {
-						pActionState->actionStarted = true;
-						pActionState->actionType = ASSET_LIST_ACTION_RENAME;
-						pActionState->targetPath = entry.path();
-					}
-					if (ImGui::MenuItem("Duplicate asset")) {
-						pActionState->actionStarted = true;
-						pActionState->actionType = ASSET_LIST_ACTION_DUPLICATE_ASSET;
-						pActionState->targetPath = entry.path();
-					}
-					if (ImGui::MenuItem("Delete asset")) {
-						pActionState->actionStarted = true;
-						pActionState->actionType = ASSET_LIST_ACTION_DELETE;
-						pActionState->targetPath = entry.path();
-					}
-					ImGui::EndPopup();
+				if (ImGui::MenuItem("Duplicate asset")) {
+					pActionState->actionStarted = true;
+					pActionState->actionType = ASSET_LIST_ACTION_DUPLICATE_ASSET;
+					pActionState->targetPath = filePath;
+				}
+				if (ImGui::MenuItem("Delete asset")) {
+					pActionState->actionStarted = true;
+					pActionState->actionType = ASSET_LIST_ACTION_DELETE;
+					pActionState->targetPath = filePath;
 				}
+				ImGui::EndPopup();
 			}
+		}
 
-			if (ImGui::BeginDragDropSource(ImGuiDragDropFlags_None))
-			{
-				ImGui::SetDragDropPayload("dd_asset", &pAssetInfo->id, sizeof(u64));
-				ImGui::Text("%s", assetName.c_str());
-
-				ImGui::EndDragDropSource();
-			}
+		if (ImGui::BeginDragDropSource(ImGuiDragDropFlags_None))
+		{
+			ImGui::SetDragDropPayload("dd_asset", &pAssetInfo->id, sizeof(u64));
+			ImGui::Text("%s", assetName.c_str());
 
-			ImGui::PopID();
+			ImGui::EndDragDropSource();
 		}
+
+		ImGui::PopID();
 	}
 
 	return result;
@@ -1626,7 +1610,8 @@ static u64 DrawAssetHierarchy(AssetType type, AssetListActionState* pActionState
 				if (targetIsDirectory) {
 					DEBUG_LOG("Deleting directory: %s\n", pActionState->targetPath.string().c_str());
 
-					std::vector<AssetEntry*> assets = CollectAssetsInDirectory(pActionState->targetPath);
+					std::vector<AssetEntry*> assets;
+					Editor::Assets::CollectAssetsInDirectory(pActionState->targetPath, assets);
 
 					for (AssetEntry* pAssetInfo : assets) {
 						DEBUG_LOG("Deleting asset: %s\n", pAssetInfo->relativePath);
@@ -1639,6 +1624,7 @@ static u64 DrawAssetHierarchy(AssetType type, AssetListActionState* pActionState
 
 					std::error_code ec;
 					u32 removedCount = std::filesystem::remove_all(pActionState->targetPath, ec);
+					Editor::Assets::InvalidateDirectoryTree();
 					if (removedCount != assets.size()) {
 						DEBUG_ERROR("Failed to delete all files in directory: %s, removed %u out of %zu\n", pActionState->targetPath.string().c_str(), removedCount, assets.size());
 					} else {
@@ -1712,6 +1698,7 @@ static u64 DrawAssetHierarchy(AssetType type, AssetListActionState* pActionState
 
 						UpdateAssetPathsWithNewDirectory(pActionState->targetPath, newDirPath);
 						std::filesystem::rename(pActionState->targetPath, newDirPath);
+						Editor::Assets::InvalidateDirectoryTree();
 					}
 					ImGui::CloseCurrentPopup();
 					pActionState->targetPath.clear();
@@ -1740,10 +1727,11 @@ static u64 DrawAssetHierarchy(AssetType type, AssetListActionState* pActionState
 					else {
 						std::filesystem::rename(pActionState->targetPath, newAssetPath);
 						std::filesystem::rename(pActionState->targetPath.string() + ".meta", newAssetPath.string() + ".meta");
+						Editor::Assets::InvalidateDirectoryTree();
 						std::string newRelativePath = std::filesystem::relative(newAssetPath, ASSETS_SRC_DIR).string();
 
 						if (newRelativePath.length() < MAX_ASSET_PATH_LENGTH) {
-							strcpy(pAssetInfo->relativePath, newRelativePath.c_str());
+							AssetManager::RenameAsset(pAssetInfo->id, newRelativePath.c_str());
 							DEBUG_LOG("Updated asset path to '%s'\n", newAssetPath.string().c_str());
 						}
 						else {
@@ -1825,6 +1813,7 @@ static u64 DrawAssetHierarchy(AssetType type, AssetListActionState* pActionState
 						}
 						else {
 							DEBUG_LOG("Created new folder: %s\n", newFolderPath.string().c_str());
+							Editor::Assets::InvalidateDirectoryTree();
 						}
 					}
 					ImGui::CloseCurrentPopup();
@@ -2316,6 +2305,45 @@ static void SavePaletteToFile(const char* fname) {
     fclose(pFile);
 }
 
+static void DrawArenaStats() {
+	for (u32 i = 0; i < ARENA_COUNT; i++) {
+		const Arena* pArena = ArenaAllocator::GetArena((ArenaType)i);
+		const ArenaStats stats = pArena->GetStats();
+
+		ImGui::PushID(i);
+		ImGui::SeparatorText(pArena->Name());
+		char overlay[64];
+		snprintf(overlay, sizeof(overlay), "%zu / %zu KB", stats.size / 1024, stats.capacity / 1024);
+		ImGui::ProgressBar(stats.capacity ? (r32)stats.size / stats.capacity : 0.0f, ImVec2(-FLT_MIN, 0), overlay);
+#ifdef ARENA_STATS
+		ImGui::Text("High water: %zu KB (%.1f%%)", stats.highWater / 1024, stats.capacity ? 100.0 * stats.highWater / stats.capacity : 0.0);
+		ImGui::Text("Allocations: %u, failed: %u, alignment padding: %zu bytes", stats.allocationCount, stats.failedAllocationCount, stats.paddingBytes);
+
+		ImGuiTableFlags flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV;
+		if (stats.tagCount > 0 && ImGui::BeginTable("tags", 3, flags)) {
+			ImGui::TableSetupColumn("Tag");
+			ImGui::TableSetupColumn("Bytes");
+			ImGui::TableSetupColumn("Count");
+			ImGui::TableHeadersRow();
+
+			for (u32 t = 0; t < stats.tagCount; t++) {
+				const ArenaTagStats& tag = stats.tags[t];
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(tag.tag);
+				ImGui::TableNextColumn();
+				ImGui::Text("%zu", tag.bytes);
+				ImGui::TableNextColumn();
+				ImGui::Text("%u", tag.count);
+			}
+
+			ImGui::EndTable();
+		}
+#endif
+		ImGui::PopID();
+	}
+}
+
 static void DrawDebugWindow() {
 	ImGui::Begin("Debug", &pContext->debugWindowOpen);
 
@@ -2426,6 +2454,23 @@ static void DrawDebugWindow() {
 			ImGui::SeparatorText("Overlay settings");
 			ImGui::Checkbox("Draw actor hitboxes", &pContext->drawActorHitboxes);
 			ImGui::Checkbox("Draw actor positions", &pContext->drawActorPositions);
+			ImGui::SeparatorText("Gameplay settings");
+			bool batchedDispatch = Game::GetActorDispatchMode() == ACTOR_DISPATCH_BATCHED;
+			if (ImGui::Checkbox("Batched actor dispatch", &batchedDispatch)) {
+				Game::SetActorDispatchMode(batchedDispatch ? ACTOR_DISPATCH_BATCHED : ACTOR_DISPATCH_POOL_ORDER);
+			}
+			bool parallelUpdate = Game::GetActorParallelUpdateEnabled();
+			if (ImGui::Checkbox("Parallel actor update", &parallelUpdate)) {
+				Game::SetActorParallelUpdateEnabled(parallelUpdate);
+			}
+			glm::vec2 activationMargin = Game::GetActorActivationMargin();
+			if (ImGui::InputFloat2("Actor activation margin", (r32*)&activationMargin)) {
+				Game::SetActorActivationMargin(activationMargin);
+			}
+			ImGui::EndTabItem();
+		}
+		if (ImGui::BeginTabItem("Memory")) {
+			DrawArenaStats();
 			ImGui::EndTabItem();
 		}
 		ImGui::EndTabBar();
@@ -2859,6 +2904,49 @@ static void DeleteRoomEditorData(EditedAsset& editedAsset) {
 	delete editedAsset.userData;
 }
 
+// Only the screens a room covers are stored, so the tiles move to a new layout when it's resized
+static bool ResizeRoomTemplate(EditedAsset& editedAsset, u32 width, u32 height) {
+	const RoomEditorData* pEditorData = (RoomEditorData*)editedAsset.userData;
+	const RoomTemplate* pOld = (RoomTemplate*)editedAsset.data;
+	const RoomTemplateLayout layout = GetRoomTemplateLayout(width, height, pEditorData->actors.Count());
+
+	u8* pNewData = (u8*)calloc(1, layout.size);
+	if (!pNewData) {
+		return false;
+	}
+
+	RoomTemplate* pNew = (RoomTemplate*)pNewData;
+	*pNew = *pOld;
+	pNew->width = (u8)width;
+	pNew->height = (u8)height;
+	pNew->mapTileOffset = layout.mapTileOffset;
+	pNew->tilemap.width = width * VIEWPORT_WIDTH_METATILES;
+	pNew->tilemap.height = height * VIEWPORT_HEIGHT_METATILES;
+	pNew->tilemap.tilesOffset = layout.tilesOffset - offsetof(RoomTemplate, tilemap);
+	pNew->actorCount = pEditorData->actors.Count();
+	pNew->actorOffset = layout.actorOffset;
+
+	const u32 mapTileRowCount = glm::min(width, (u32)pOld->width) * 2;
+	for (u32 y = 0; y < height && y < pOld->height; y++) {
+		memcpy(pNew->GetMapTiles() + y * width * 2, pOld->GetMapTiles() + y * pOld->width * 2, mapTileRowCount * sizeof(BgTile));
+	}
+
+	const u32 tileRowCount = glm::min(pNew->tilemap.width, pOld->tilemap.width);
+	for (u32 y = 0; y < pNew->tilemap.height && y < pOld->tilemap.height; y++) {
+		memcpy(pNew->tilemap.GetTileData() + y * pNew->tilemap.width, pOld->tilemap.GetTileData() + y * pOld->tilemap.width, tileRowCount);
+	}
+
+	RoomActor* pActors = pNew->GetActors();
+	for (u32 i = 0; i < pNew->actorCount; i++) {
+		pActors[i] = *pEditorData->actors.Get(pEditorData->actors.GetHandle(i));
+	}
+
+	free(editedAsset.data);
+	editedAsset.data = pNewData;
+	editedAsset.size = layout.size;
+	return true;
+}
+
 static void DrawScreenBorders(u32 index, ImVec2 pMin, ImVec2 pMax, r32 renderScale) {
 	ImDrawList* drawList = ImGui::GetWindowDrawList();
 	
@@ -3044,9 +3132,12 @@ static void DrawRoomTools(EditedAsset& asset) {
 
 			s32 size[2] = { pTemplate->width, pTemplate->height };
 			if (ImGui::InputInt2("Size", size)) {
-				pTemplate->width = glm::clamp(size[0], 1, s32(ROOM_MAX_DIM_SCREENS));
-				pTemplate->height = glm::clamp(size[1], 1, s32(ROOM_MAX_DIM_SCREENS));
-				asset.dirty = true;
+				const u32 width = glm::clamp(size[0], 1, s32(ROOM_MAX_DIM_SCREENS));
+				const u32 height = glm::clamp(size[1], 1, s32(ROOM_MAX_DIM_SCREENS));
+				if ((width != pTemplate->width || height != pTemplate->height) && ResizeRoomTemplate(asset, width, height)) {
+					pTemplate = (RoomTemplate*)asset.data;
+					asset.dirty = true;
+				}
 			}
 
 			ImGui::SeparatorText("Map visuals");
@@ -3065,7 +3156,7 @@ static void DrawRoomTools(EditedAsset& asset) {
 				}
 				const s32 xTile = selectedTile % (pTemplate->width * 2);
 				const s32 yTile = selectedTile / (pTemplate->width * 2);
-				const s32 roomTileIndex = xTile + yTile * ROOM_MAX_DIM_SCREENS * 2;
+				const s32 roomTileIndex = xTile + yTile * pTemplate->width * 2;
 
 				BgTile* mapTiles = pTemplate->GetMapTiles();
 
@@ -3092,7 +3183,7 @@ static void DrawRoomTools(EditedAsset& asset) {
 
 				for (u32 y = 0; y < pTemplate->height; y++) {
 					for (u32 x = 0; x < pTemplate->width * 2; x++) {
-						const s32 tileIndex = x + y * ROOM_MAX_DIM_SCREENS * 2;
+						const s32 tileIndex = x + y * pTemplate->width * 2;
 						const BgTile& tile = mapTiles[tileIndex];
 
 						const u8 index = (u8)tile.tileId & 0xFF;
@@ -3365,6 +3456,9 @@ static void DrawActorEditor(EditedAsset& asset) {
 				if (DrawTypeSelectionCombo("Subtype", editorData.subtypeNames, subtypeCount, pPrototype->subtype, false)) {
 					asset.dirty = true;
 				}
+				if (DrawTypeSelectionCombo("Activation", ACTOR_ACTIVATION_NAMES, ACTOR_ACTIVATION_COUNT, pPrototype->activation, false)) {
+					asset.dirty = true;
+				}
 
 				ImGui::SeparatorText("Type data");
 
@@ -4389,6 +4483,8 @@ static void DrawAssetBrowser() {
 	{
 		if (ImGui::BeginMenu("File")) {
 			if (ImGui::MenuItem("Save archive")) {
+				// Edits may have changed what assets reference
+				AssetManager::RebuildDependencies(AssetSerialization::GetAssetDependencies);
 				AssetManager::SaveArchive(ASSETS_NPAK_OUTPUT);
 			}
 			if (ImGui::MenuItem("Reload archive")) {
@@ -5022,9 +5118,13 @@ void Editor::Init(SDL_Window *pWindow) {
 	u32* colorPixels = Rendering::GetEditorTexturePixels(pContext->pColorTexture);
 	memcpy(colorPixels, Rendering::Software::GetPaletteColors(), COLOR_COUNT * sizeof(u32));
 	Rendering::UpdateEditorTexture(pContext->pColorTexture);
+
+	Editor::Assets::StartWatching(ASSETS_SRC_DIR);
 }
 
 void Editor::Free() {
+	Editor::Assets::StopWatching();
+
 	Rendering::FreeEditorTexture(pContext->pChrTexture);
 	free(pContext->pChrTexture);
 	Rendering::FreeEditorTexture(pContext->pPaletteTexture);
@@ -5069,6 +5169,9 @@ void Editor::ProcessEvent(const SDL_Event* event) {
 void Editor::Update(r64 dt) {
 	pContext->secondsElapsed += dt;
 
+	// Before drawing, so nothing holds on to asset data or directories that change
+	Editor::Assets::ProcessFileChanges();
+
 	// Clean up deleted textures
 	for (auto pTempTexture : pContext->tempTextureEraseList) {
 		pContext->tempRenderTextures.erase(pTempTexture);
@@ -4,18 +4,26 @@
 #include "asset_serialization.h"
 #include "random.h"
 #include "asset_manager.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#ifdef PLATFORM_LINUX
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
 
 #pragma region Size calculation
 static u32 GetRoomTemplateSize(const RoomTemplate* pHeader) {
-	u32 result = sizeof(RoomTemplate);
-	constexpr u32 tilemapSize = ROOM_MAX_SCREEN_COUNT * ROOM_SCREEN_TILE_COUNT;
-	result += tilemapSize;
-	result += ROOM_MAP_TILE_COUNT * sizeof(BgTile);
-	if (pHeader) {
-		result += pHeader->actorCount * sizeof(RoomActor);
+	if (!pHeader) {
+		return GetRoomTemplateLayout(1, 1, 0).size;
 	}
 
-	return result;
+	return GetRoomTemplateLayout(pHeader->width, pHeader->height, pHeader->actorCount).size;
 }
 
 static u32 GetActorPrototypeSize(const ActorPrototype* pHeader) {
@@ -63,24 +71,22 @@ static u32 GetOverworldSize(const Overworld* pHeader) {
 
 #pragma region Initialization
 static void InitRoomTemplate(void* data) {
-	constexpr u32 mapTilesOffset = sizeof(RoomTemplate);
-	constexpr u32 tilesOffset = mapTilesOffset + ROOM_MAP_TILE_COUNT * sizeof(BgTile);
-	constexpr u32 actorsOffset = tilesOffset + ROOM_MAX_SCREEN_COUNT * ROOM_SCREEN_TILE_COUNT;
+	constexpr RoomTemplateLayout layout = GetRoomTemplateLayout(1, 1, 0);
 
 	Tilemap tilemap{
-		.width = ROOM_MAX_DIM_SCREENS * VIEWPORT_WIDTH_METATILES,
-		.height = ROOM_MAX_DIM_SCREENS * VIEWPORT_HEIGHT_METATILES,
+		.width = VIEWPORT_WIDTH_METATILES,
+		.height = VIEWPORT_HEIGHT_METATILES,
 		.tilesetHandle = TilesetHandle::Null(),
-		.tilesOffset = tilesOffset - offsetof(RoomTemplate, tilemap),
+		.tilesOffset = layout.tilesOffset - offsetof(RoomTemplate, tilemap),
 	};
 
 	RoomTemplate newHeader{
 		.width = 1,
 		.height = 1,
-		.mapTileOffset = mapTilesOffset,
+		.mapTileOffset = layout.mapTileOffset,
 		.tilemap = tilemap,
 		.actorCount = 0,
-		.actorOffset = actorsOffset
+		.actorOffset = layout.actorOffset
 	};
 
 	memcpy(data, &newHeader, sizeof(RoomTemplate));
@@ -243,45 +249,453 @@ bool Editor::Assets::LoadAssetsFromDirectory(const std::filesystem::path& direct
 
 	DEBUG_LOG("Listing assets in directory: %s\n", directory.string().c_str());
 
-	std::vector<u8> data;
-	for (const auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
-		AssetType assetType;
-		if (entry.is_regular_file() && AssetSerialization::TryGetAssetTypeFromPath(entry.path(), assetType) == SERIALIZATION_SUCCESS) {
-			const std::string pathStr = entry.path().string();
-			const char* pathCStr = pathStr.c_str();
-			DEBUG_LOG("Found %s: %s\n", ASSET_TYPE_NAMES[assetType], pathCStr);
+	std::vector<AssetSerialization::AssetSource> sources;
+	AssetSerialization::FindAssetSources(directory, sources);
 
+	// Source file sizes are close enough to the serialized sizes to reserve storage up front
+	size_t estimatedSize = 0;
+	for (const AssetSerialization::AssetSource& source : sources) {
+		// Missing metadata is created before loading goes wide, since generating ids isn't thread safe
+		if (!AssetSerialization::HasMetadata(source.path)) {
+			DEBUG_LOG("No metadata found for asset %s, creating new metadata file\n", source.path.string().c_str());
 			nlohmann::json metadata;
-			if (!AssetSerialization::HasMetadata(entry.path())) {
-				DEBUG_LOG("No metadata found for asset %s, creating new metadata file\n", pathCStr);
-				u64 guid = Random::GenerateUUID();
-				if (AssetSerialization::CreateAssetMetadataFile(entry.path(), guid, metadata) != SERIALIZATION_SUCCESS) {
-					DEBUG_ERROR("Failed to create metadata for asset %s\n", pathCStr);
-					continue;
-				}
+			u64 guid = Random::GenerateUUID();
+			if (AssetSerialization::CreateAssetMetadataFile(source.path, guid, metadata) != SERIALIZATION_SUCCESS) {
+				DEBUG_ERROR("Failed to create metadata for asset %s\n", source.path.string().c_str());
 			}
+		}
+		estimatedSize += source.fileSize;
+	}
+	AssetManager::BeginBulkAdd((u32)sources.size(), estimatedSize);
 
-			if (AssetSerialization::LoadAssetMetadataFromFile(entry.path(), metadata) != SERIALIZATION_SUCCESS) {
-				DEBUG_ERROR("Failed to load metadata for asset %s\n", pathCStr);
-				continue;
+	// Unchanged sources are loaded from their serialized form instead of being parsed
+	auto loadAsset = [](const AssetSerialization::AssetSource& source, u64& outId, std::vector<u8>& outData) {
+		bool fromCache;
+		return AssetSerialization::LoadAssetCached(source, ASSETS_CACHE_DIR, outId, outData, fromCache);
+	};
+
+	auto addAsset = [](const AssetSerialization::AssetSource& source, SerializationResult result, u64 guid, const u8* pData, size_t size) {
+		const std::string pathStr = source.path.string();
+		const char* pathCStr = pathStr.c_str();
+		DEBUG_LOG("Found %s: %s\n", ASSET_TYPE_NAMES[source.type], pathCStr);
+
+		if (result == SERIALIZATION_INVALID_METADATA) {
+			DEBUG_ERROR("Failed to load metadata for asset %s\n", pathCStr);
+			return;
+		}
+		if (result != SERIALIZATION_SUCCESS) {
+			DEBUG_ERROR("Failed to load asset %s\n", pathCStr);
+			return;
+		}
+
+		const std::filesystem::path relativePath = std::filesystem::relative(source.path, ASSETS_SRC_DIR);
+		if (!AssetManager::AddAsset(guid, source.type, size, relativePath.string().c_str(), pData)) {
+			DEBUG_ERROR("Failed to add asset %s to manager\n", pathCStr);
+			return;
+		}
+		DEBUG_LOG("Asset %s loaded successfully with GUID: %llu\n", pathCStr, guid);
+	};
+
+	AssetSerialization::LoadAssetsParallel(sources, loadAsset, addAsset);
+
+	AssetManager::EndBulkAdd();
+	return true;
+}
+
+#pragma region Directory watching
+// A batch of changes is processed once no events have arrived for this long, editors tend to write in bursts
+static constexpr int WATCH_QUIET_PERIOD_MS = 100;
+
+struct AssetReload {
+	std::filesystem::path relativePath;
+	AssetType type;
+	u64 id;
+	std::vector<u8> data;
+	bool removed;
+	// Logged on the main thread, the editor console isn't thread safe
+	bool failed;
+	// New sources get their metadata on the main thread, writing it triggers the actual reload
+	bool missingMetadata;
+};
+
+static std::filesystem::path g_watchedDirectory;
+static std::vector<Editor::Assets::AssetDirectory> g_directories;
+static std::unordered_map<std::string, u32> g_directoryLookup;
+static std::atomic<bool> g_directoryTreeDirty = false;
+
+static std::thread g_watcherThread;
+static std::atomic<bool> g_stopWatcher = false;
+static int g_watchFd = -1;
+
+// Filled by the watcher thread, applied by ProcessFileChanges
+static std::mutex g_reloadMutex;
+static std::vector<AssetReload> g_pendingReloads;
+
+static std::string GetDirectoryKey(const std::filesystem::path& path) {
+	return path.lexically_normal().generic_string();
+}
+
+static u32 ScanDirectory(const std::filesystem::path& path) {
+	const u32 index = (u32)g_directories.size();
+	g_directories.push_back({ path });
+	g_directoryLookup[GetDirectoryKey(path)] = index;
+
+	std::vector<std::filesystem::path> subdirectoryPaths;
+	std::vector<std::filesystem::path> files;
+	u32 assetTypeMask = 0;
+
+	std::error_code err;
+	for (const auto& entry : std::filesystem::directory_iterator(path, err)) {
+		AssetType assetType;
+		if (entry.is_directory()) {
+			subdirectoryPaths.push_back(entry.path());
+		}
+		else if (entry.is_regular_file() && AssetSerialization::TryGetAssetTypeFromPath(entry.path(), assetType) == SERIALIZATION_SUCCESS) {
+			files.push_back(entry.path());
+			assetTypeMask |= 1 << assetType;
+		}
+	}
+	std::sort(subdirectoryPaths.begin(), subdirectoryPaths.end());
+	std::sort(files.begin(), files.end());
+
+	// Scanning subdirectories grows the list, so the node is only touched through its index
+	std::vector<u32> subdirectories;
+	for (const std::filesystem::path& subdirectoryPath : subdirectoryPaths) {
+		const u32 subdirectory = ScanDirectory(subdirectoryPath);
+		subdirectories.push_back(subdirectory);
+		assetTypeMask |= g_directories[subdirectory].assetTypeMask;
+	}
+
+	Editor::Assets::AssetDirectory& directory = g_directories[index];
+	directory.subdirectories = std::move(subdirectories);
+	directory.files = std::move(files);
+	directory.assetTypeMask = assetTypeMask;
+	return index;
+}
+
+static void RebuildDirectoryTree() {
+	g_directories.clear();
+	g_directoryLookup.clear();
+	if (!g_watchedDirectory.empty()) {
+		ScanDirectory(g_watchedDirectory);
+	}
+}
+
+#ifdef PLATFORM_LINUX
+static constexpr u32 WATCH_EVENT_MASK = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+
+// inotify isn't recursive, so every directory gets its own watch
+static void AddWatchesRecursive(const std::filesystem::path& path, std::unordered_map<int, std::filesystem::path>& watches) {
+	const int wd = inotify_add_watch(g_watchFd, path.string().c_str(), WATCH_EVENT_MASK | IN_ONLYDIR);
+	if (wd < 0) {
+		DEBUG_ERROR("Failed to watch directory %s\n", path.string().c_str());
+		return;
+	}
+	watches[wd] = path;
+
+	std::error_code err;
+	for (const auto& entry : std::filesystem::directory_iterator(path, err)) {
+		if (entry.is_directory()) {
+			AddWatchesRecursive(entry.path(), watches);
+		}
+	}
+}
+
+static void ReloadChangedAssets(const std::unordered_set<std::string>& changedPaths) {
+	std::vector<AssetReload> reloads;
+	for (const std::string& pathStr : changedPaths) {
+		// Metadata changes reload the asset they belong to
+		std::filesystem::path path = pathStr;
+		if (path.extension() == ".meta") {
+			path.replace_extension("");
+		}
+
+		AssetType type;
+		if (AssetSerialization::TryGetAssetTypeFromPath(path, type) != SERIALIZATION_SUCCESS) {
+			continue;
+		}
+
+		AssetReload reload{};
+		reload.relativePath = std::filesystem::relative(path, g_watchedDirectory);
+		reload.type = type;
+
+		std::error_code err;
+		if (!std::filesystem::exists(path, err)) {
+			reload.removed = true;
+			reloads.push_back(std::move(reload));
+			continue;
+		}
+
+		if (!AssetSerialization::HasMetadata(path)) {
+			reload.missingMetadata = true;
+			reloads.push_back(std::move(reload));
+			continue;
+		}
+
+		const AssetSerialization::AssetSource source{ path, type, 0 };
+		bool fromCache;
+		SerializationResult result;
+		try {
+			result = AssetSerialization::LoadAssetCached(source, ASSETS_CACHE_DIR, reload.id, reload.data, fromCache);
+		}
+		catch (const std::exception&) {
+			result = SERIALIZATION_INVALID_ASSET_DATA;
+		}
+
+		// Likely caught halfway through a save, the next write reloads it again
+		reload.failed = result != SERIALIZATION_SUCCESS;
+		reloads.push_back(std::move(reload));
+	}
+
+	if (reloads.empty()) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(g_reloadMutex);
+	for (AssetReload& reload : reloads) {
+		g_pendingReloads.push_back(std::move(reload));
+	}
+}
+
+static void WatcherLoop() {
+	std::unordered_map<int, std::filesystem::path> watches;
+	AddWatchesRecursive(g_watchedDirectory, watches);
+
+	std::unordered_set<std::string> changedPaths;
+	bool structureChanged = false;
+	alignas(inotify_event) char buffer[4096];
+
+	while (!g_stopWatcher) {
+		pollfd pfd{ g_watchFd, POLLIN, 0 };
+		const int ready = poll(&pfd, 1, WATCH_QUIET_PERIOD_MS);
+		if (ready < 0) {
+			break;
+		}
+
+		if (ready == 0) {
+			if (structureChanged) {
+				g_directoryTreeDirty = true;
+				structureChanged = false;
+			}
+			if (!changedPaths.empty()) {
+				ReloadChangedAssets(changedPaths);
+				changedPaths.clear();
 			}
+			continue;
+		}
 
-			const u64 guid = metadata["guid"];
+		const ssize_t length = read(g_watchFd, buffer, sizeof(buffer));
+		if (length <= 0) {
+			continue;
+		}
 
-			data.clear();
-			if (AssetSerialization::LoadAssetFromFile(entry.path(), assetType, metadata, data) != SERIALIZATION_SUCCESS) {
-				DEBUG_ERROR("Failed to load asset %s\n", pathCStr);
+		for (const char* p = buffer; p < buffer + length; p += sizeof(inotify_event) + ((const inotify_event*)p)->len) {
+			const inotify_event* pEvent = (const inotify_event*)p;
+			if (pEvent->mask & IN_IGNORED) {
+				watches.erase(pEvent->wd);
 				continue;
 			}
 
-			const std::filesystem::path relativePath = std::filesystem::relative(entry.path(), ASSETS_SRC_DIR);
-			if (!AssetManager::AddAsset(guid, assetType, data.size(), relativePath.string().c_str(), data.data())) {
-				DEBUG_ERROR("Failed to add asset %s to manager\n", pathCStr);
+			auto it = watches.find(pEvent->wd);
+			if (it == watches.end() || pEvent->len == 0) {
 				continue;
 			}
-			DEBUG_LOG("Asset %s loaded successfully with GUID: %llu\n", pathCStr, guid);
+			const std::filesystem::path path = it->second / pEvent->name;
+
+			if (pEvent->mask & IN_ISDIR) {
+				if (pEvent->mask & (IN_CREATE | IN_MOVED_TO)) {
+					AddWatchesRecursive(path, watches);
+
+					// Files moved in with the directory, or written before the watch was added, have no events of their own
+					std::error_code err;
+					for (const auto& entry : std::filesystem::recursive_directory_iterator(path, err)) {
+						if (entry.is_regular_file()) {
+							changedPaths.insert(entry.path().string());
+						}
+					}
+				}
+				structureChanged = true;
+				continue;
+			}
+
+			if (pEvent->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)) {
+				structureChanged = true;
+			}
+			// Creation is followed by a close once the file has been written
+			if (!(pEvent->mask & IN_CREATE)) {
+				changedPaths.insert(path.string());
+			}
 		}
 	}
+}
+#endif
 
-	return true;
-}
\ No newline at end of file
+void Editor::Assets::StartWatching(const std::filesystem::path& directory) {
+	StopWatching();
+
+	g_watchedDirectory = directory;
+	RebuildDirectoryTree();
+
+#ifdef PLATFORM_LINUX
+	g_watchFd = inotify_init1(IN_CLOEXEC);
+	if (g_watchFd < 0) {
+		DEBUG_ERROR("Failed to initialize inotify, assets won't be reloaded\n");
+		return;
+	}
+
+	g_stopWatcher = false;
+	g_watcherThread = std::thread(WatcherLoop);
+#else
+	DEBUG_WARN("Asset hot reloading isn't supported on this platform\n");
+#endif
+}
+
+void Editor::Assets::StopWatching() {
+	if (g_watcherThread.joinable()) {
+		g_stopWatcher = true;
+		g_watcherThread.join();
+	}
+
+#ifdef PLATFORM_LINUX
+	if (g_watchFd >= 0) {
+		close(g_watchFd);
+		g_watchFd = -1;
+	}
+#endif
+
+	std::lock_guard<std::mutex> lock(g_reloadMutex);
+	g_pendingReloads.clear();
+}
+
+static void ApplyAssetReload(const AssetReload& reload) {
+	const std::string pathStr = reload.relativePath.string();
+	const char* pathCStr = pathStr.c_str();
+
+	if (reload.removed) {
+		AssetEntry* pAssetInfo = AssetManager::GetAssetInfoFromPath(reload.relativePath);
+		if (pAssetInfo && !pAssetInfo->flags.deleted) {
+			DEBUG_LOG("Asset source %s was removed, removing asset\n", pathCStr);
+			AssetManager::RemoveAsset(pAssetInfo->id);
+		}
+		return;
+	}
+
+	if (reload.failed) {
+		DEBUG_WARN("Failed to reload asset %s\n", pathCStr);
+		return;
+	}
+
+	if (reload.missingMetadata) {
+		// The editor may have written the metadata itself since
+		const std::filesystem::path path = g_watchedDirectory / reload.relativePath;
+		if (AssetSerialization::HasMetadata(path)) {
+			return;
+		}
+
+		// Only the metadata was deleted, keep the id so references to the asset stay valid
+		const AssetEntry* pExisting = AssetManager::GetAssetInfoFromPath(reload.relativePath);
+		const bool keepId = pExisting && !pExisting->flags.deleted;
+		const u64 id = keepId ? pExisting->id : Random::GenerateUUID();
+
+		DEBUG_LOG("No metadata found for asset %s, creating new metadata file\n", pathCStr);
+		nlohmann::json metadata;
+		if (AssetSerialization::CreateAssetMetadataFile(path, id, metadata) != SERIALIZATION_SUCCESS) {
+			DEBUG_ERROR("Failed to create metadata for asset %s, skipping it\n", pathCStr);
+		}
+		return;
+	}
+
+	AssetEntry* pAssetInfo = AssetManager::GetAssetInfo(reload.id);
+	if (!pAssetInfo) {
+		if (AssetManager::AddAsset(reload.id, reload.type, reload.data.size(), pathCStr, reload.data.data())) {
+			DEBUG_LOG("Added asset %s\n", pathCStr);
+		}
+		return;
+	}
+
+	if (pAssetInfo->flags.deleted || pAssetInfo->flags.type != reload.type) {
+		DEBUG_WARN("Can't reload %s over a deleted asset or one of another type\n", pathCStr);
+		return;
+	}
+
+	// Moved outside the editor
+	if (reload.relativePath != pAssetInfo->relativePath) {
+		AssetManager::RenameAsset(reload.id, pathCStr);
+	}
+
+	// Saving from the editor reloads the asset too, but the data already matches
+	if (pAssetInfo->size == reload.data.size() && memcmp(AssetManager::GetAsset(reload.id, reload.type), reload.data.data(), reload.data.size()) == 0) {
+		return;
+	}
+
+	if (pAssetInfo->size != reload.data.size() && !AssetManager::ResizeAsset(reload.id, reload.data.size())) {
+		DEBUG_ERROR("Failed to resize asset %s for reloading\n", pathCStr);
+		return;
+	}
+
+	memcpy(AssetManager::GetAsset(reload.id, reload.type), reload.data.data(), reload.data.size());
+	AssetManager::MarkAssetsModified();
+	DEBUG_LOG("Reloaded asset %s\n", pathCStr);
+}
+
+void Editor::Assets::ProcessFileChanges() {
+	std::vector<AssetReload> reloads;
+	{
+		std::lock_guard<std::mutex> lock(g_reloadMutex);
+		reloads.swap(g_pendingReloads);
+	}
+
+	// Removals go last, so an asset moved outside the editor is renamed instead of removed
+	for (const AssetReload& reload : reloads) {
+		if (!reload.removed) {
+			ApplyAssetReload(reload);
+		}
+	}
+	for (const AssetReload& reload : reloads) {
+		if (reload.removed) {
+			ApplyAssetReload(reload);
+		}
+	}
+
+	if (g_directoryTreeDirty.exchange(false)) {
+		RebuildDirectoryTree();
+	}
+}
+
+void Editor::Assets::InvalidateDirectoryTree() {
+	g_directoryTreeDirty = true;
+}
+
+const Editor::Assets::AssetDirectory* Editor::Assets::GetDirectory(const std::filesystem::path& path) {
+	auto it = g_directoryLookup.find(GetDirectoryKey(path));
+	if (it == g_directoryLookup.end()) {
+		return nullptr;
+	}
+	return &g_directories[it->second];
+}
+
+const Editor::Assets::AssetDirectory* Editor::Assets::GetDirectory(u32 index) {
+	if (index >= g_directories.size()) {
+		return nullptr;
+	}
+	return &g_directories[index];
+}
+
+void Editor::Assets::CollectAssetsInDirectory(const std::filesystem::path& path, std::vector<AssetEntry*>& outAssets) {
+	const AssetDirectory* pDirectory = GetDirectory(path);
+	if (!pDirectory) {
+		return;
+	}
+
+	for (const std::filesystem::path& file : pDirectory->files) {
+		AssetEntry* pAssetInfo = AssetManager::GetAssetInfoFromPath(std::filesystem::relative(file, ASSETS_SRC_DIR));
+		if (pAssetInfo && !pAssetInfo->flags.deleted) {
+			outAssets.push_back(pAssetInfo);
+		}
+	}
+
+	for (u32 subdirectory : pDirectory->subdirectories) {
+		CollectAssetsInDirectory(g_directories[subdirectory].path, outAssets);
+	}
+}
+#pragma endregion
@@ -2,10 +2,36 @@
 #include "asset_types.h"
 #include <filesystem>
 #include <map>
+#include <vector>
+
+struct AssetEntry;
 
 namespace Editor::Assets {
 	void InitializeAsset(AssetType type, void* pData);
 	u32 GetAssetSize(AssetType type, const void* pData);
 
 	bool LoadAssetsFromDirectory(const std::filesystem::path& directory);
+
+	struct AssetDirectory {
+		std::filesystem::path path;
+		std::vector<u32> subdirectories; // Sorted, see GetDirectory
+		std::vector<std::filesystem::path> files; // Asset sources without metadata, sorted
+		u32 assetTypeMask; // Types of the assets in the directory and its subdirectories
+	};
+
+	// Watches the directory for changes from outside the editor (inotify, Linux only) and keeps a cached tree of it.
+	// Changed assets are serialized on the watcher thread and swapped into the asset manager by ProcessFileChanges
+	void StartWatching(const std::filesystem::path& directory);
+	void StopWatching();
+	// Call once per frame on the main thread. Applies reloaded assets and rescans the tree if it changed
+	void ProcessFileChanges();
+	// Rescans the tree on the next ProcessFileChanges. The editor calls this after its own file operations,
+	// so the tree stays current without a watcher
+	void InvalidateDirectoryTree();
+
+	// Directories stay valid until the next ProcessFileChanges. Returns null for directories that aren't in the tree
+	const AssetDirectory* GetDirectory(const std::filesystem::path& path);
+	const AssetDirectory* GetDirectory(u32 index);
+	// Entries of the asset sources in the directory and its subdirectories
+	void CollectAssetsInDirectory(const std::filesystem::path& path, std::vector<AssetEntry*>& outAssets);
 }
\ No newline at end of file
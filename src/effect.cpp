@@ -2,66 +2,10 @@
 #include "game.h"
 #include "game_rendering.h"
 #include "audio.h"
-#include <cstdio>
-#include <cstring>
-
-// Calls itoa, but adds a plus sign if value is positive
-static size_t ItoaSigned(s16 value, char* str) {
-    s32 i = 0;
-    if (value > 0) {
-        str[i++] = '+';
-    }
-
-    sprintf(str + i, "%d", value);
-
-    return strlen(str);
-}
+#include "particles.h"
 
 static bool DrawDmgNumbers(const Actor* pActor) {
-    const Damage& damage = pActor->data.dmgNumber.damage;
-
-    static char numberStr[16]{};
-
-    s16 value = damage.value;
-    if (!damage.flags.healing) {
-        value *= -1;
-    }
-    const u8 strLength = (u8)ItoaSigned(value, numberStr);
-
-    // Ascii character '*' = 0x2A
-    constexpr u8 chrOffset = 0x2A;
-	constexpr u16 chrWidth = 6;
-    const u8 palette = damage.flags.healing ? 0x3 : 0x1;
-
-    const glm::i16vec2 pixelPos = Game::Rendering::WorldPosToScreenPixels(pActor->position);
-
-    const s16 widthPx = strLength * chrWidth;
-    const s16 xStart = pixelPos.x - widthPx / 2;
-
-    bool result = true;
-    for (u8 i = 0; i < strLength; i++) {
-        Sprite sprite{};
-        sprite.tileId = 0x90 + numberStr[i] - chrOffset;
-        sprite.palette = palette;
-        sprite.x = xStart + i * chrWidth;
-        sprite.y = pixelPos.y;
-        result &= Game::Rendering::DrawSprite(SPRITE_LAYER_UI, Game::GetConfig().uiBankHandle, sprite);
-    }
-
-	if (damage.flags.crit) {
-        const s16 xCrit = pixelPos.x - chrWidth * 2;
-		const s16 yCrit = pixelPos.y - TILE_DIM_PIXELS;
-		for (u32 i = 0; i < 4; i++) {
-			Sprite sprite{};
-			sprite.tileId = 0xa0 + i;
-			sprite.palette = palette;
-			sprite.x = xCrit + i * chrWidth;
-			sprite.y = yCrit;
-			result &= Game::Rendering::DrawSprite(SPRITE_LAYER_UI, Game::GetConfig().uiBankHandle, sprite);
-		}
-	}
-
-    return result;
+    return Game::DrawDamageNumbers(pActor->data.dmgNumber.damage, pActor->position);
 }
 
 static void UpdateExplosion(Actor* pActor) {
@@ -126,6 +70,11 @@ constexpr ActorUpdateFn Game::effectUpdateTable[EFFECT_TYPE_COUNT] = {
     UpdateExplosion,
     UpdateFeather,
 };
+constexpr ActorBatchUpdateFn Game::effectBatchUpdateTable[EFFECT_TYPE_COUNT] = {
+    Game::UpdateActorBatch<UpdateDmgNumbers>,
+    Game::UpdateActorBatch<UpdateExplosion>,
+    Game::UpdateActorBatch<UpdateFeather>,
+};
 constexpr ActorDrawFn Game::effectDrawTable[EFFECT_TYPE_COUNT] = {
     DrawDmgNumbers,
     Game::DrawActorDefault,
@@ -2,6 +2,7 @@
 #include "game_rendering.h"
 #include "game_state.h"
 #include "random.h"
+#include "particles.h"
 
 // TODO: Should be determined by enemy stats
 constexpr u16 baseDamage = 10;
@@ -85,7 +86,7 @@ static void UpdateSkullEnemy(Actor* pActor) {
 
 static void FireballDie(Actor* pActor, const glm::vec2& effectPos) {
     pActor->flags.pendingRemoval = true;
-    Game::SpawnActor(pActor->data.fireball.deathEffect, effectPos);
+    Game::SpawnEffect(pActor->data.fireball.deathEffect, effectPos);
 }
 
 static void UpdateFireball(Actor* pActor) {
@@ -128,7 +129,7 @@ void Game::EnemyDie(Actor* pActor) {
     }
     else SetPersistedActorData(pActor->persistId, { .dead = true });
 
-    SpawnActor(pActor->data.enemy.deathEffect, pActor->position);
+    SpawnEffect(pActor->data.enemy.deathEffect, pActor->position);
 
     // Spawn exp halos
     const u16 totalExpValue = pActor->data.enemy.expValue;
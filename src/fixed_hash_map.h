@@ -1,138 +1,327 @@
 #pragma once
 #include "typedef.h"
 #include "random.h"
-
-static constexpr u32 HASH_MAP_SIZE = 65536;
-static constexpr u32 HASH_MAP_SIZE_MASK = HASH_MAP_SIZE - 1;
-static constexpr u32 HASH_MAP_SIZE_BITS = 16;
-static constexpr u32 HASH_MAP_SHIFT_BITS = 64 - HASH_MAP_SIZE_BITS;
+#include "memory_arena.h"
+#include <cstring>
+#include <bit>
+#include <utility>
 
 template <typename T>
-class FixedHashMapBucket {
-public:
-	u64 key = UUID_NULL;
-	T value;
+struct FixedHashMapEntry {
+	u64 key;
+	T& value;
 };
 
-template <typename T, typename TBucket = FixedHashMapBucket<T>>
-class FixedHashMap {
-private:
-	TBucket data[HASH_MAP_SIZE];
-
-	u32 Hash(u64 key) const {
+// Robin Hood probing shared by FixedHashMap and DynamicHashMap. Capacity must be a power of two
+namespace RobinHood {
+	inline u32 Hash(u64 key, u32 capacityBits) {
 		// Thank you Donald Knuth
-		key ^= key >> HASH_MAP_SHIFT_BITS;
-		return (key * 11400714819323198485ULL) >> HASH_MAP_SHIFT_BITS;
-	}
-	u32 Rehash(u32 hash) const {
-		return (hash + 1) & HASH_MAP_SIZE_MASK;
+		key ^= key >> (64 - capacityBits);
+		return (u32)((key * 11400714819323198485ULL) >> (64 - capacityBits));
 	}
-	bool Probe(u64 key, u32& hash) const {
-		u32 count = 0;
-		hash = Hash(key);
 
-		while (count < HASH_MAP_SIZE) {
-			if (data[hash].key == UUID_NULL) {
-				return false;  // Empty slot found
-			}
-			if (data[hash].key == key) {
-				return true;  // Key found
+	inline bool Find(const u64* keys, const u16* distances, u32 capacityBits, u64 key, u32& index) {
+		if (key == UUID_NULL) {
+			return false;
+		}
+
+		const u32 mask = (1u << capacityBits) - 1;
+		u32 i = Hash(key, capacityBits);
+		u16 distance = 1;
+
+		// Every key further along the chain would have displaced this one if it was there
+		while (distances[i] >= distance) {
+			if (keys[i] == key) {
+				index = i;
+				return true;
 			}
-			hash = Rehash(hash);
-			count++;
+			i = (i + 1) & mask;
+			distance++;
 		}
 
-		return false;  // Full map, key not found
+		return false;
 	}
-	bool GetHash(u64 key, u32& hash) const {
-		if (key == UUID_NULL) {
-			return false;
+
+	// The key must not be in the map yet and there must be a free slot
+	template <typename T>
+	void Insert(u64* keys, T* values, u16* distances, u32 capacityBits, u64 key, const T& value) {
+		const u32 mask = (1u << capacityBits) - 1;
+		u64 insertKey = key;
+		T insertValue = value;
+		u16 distance = 1;
+		u32 i = Hash(key, capacityBits);
+
+		while (distances[i] != 0) {
+			// Take the slot from entries closer to their ideal position
+			if (distances[i] < distance) {
+				std::swap(insertKey, keys[i]);
+				std::swap(insertValue, values[i]);
+				std::swap(distance, distances[i]);
+			}
+			i = (i + 1) & mask;
+			distance++;
 		}
 
-		hash = Hash(key);
+		keys[i] = insertKey;
+		values[i] = insertValue;
+		distances[i] = distance;
+	}
 
-		if (Probe(key, hash)) {
-			return true;
+	template <typename T>
+	void RemoveAt(u64* keys, T* values, u16* distances, u32 capacityBits, u32 i) {
+		const u32 mask = (1u << capacityBits) - 1;
+
+		// Shift the rest of the chain back by one instead of leaving a tombstone
+		u32 next = (i + 1) & mask;
+		while (distances[next] > 1) {
+			keys[i] = keys[next];
+			values[i] = values[next];
+			distances[i] = distances[next] - 1;
+			i = next;
+			next = (next + 1) & mask;
 		}
 
-		return false;
+		keys[i] = UUID_NULL;
+		values[i] = T{};
+		distances[i] = 0;
+	}
+}
+
+// Open addressing hash map with Robin Hood probing and backward shift deletion.
+// Keys and probe distances are kept in their own arrays, so lookups only touch the metadata until a key matches.
+// UUID_NULL is reserved as the empty key
+template <typename T, u32 capacity>
+class FixedHashMap {
+private:
+	static_assert(capacity >= 2 && (capacity & (capacity - 1)) == 0, "Capacity must be a power of two");
+
+	static constexpr u32 CAPACITY_BITS = std::countr_zero(capacity);
+	// Keeping some slots free bounds the probe lengths
+	static constexpr u32 MAX_COUNT = capacity - capacity / 8;
+
+	u64 keys[capacity];
+	T values[capacity];
+	// Distance from the ideal slot plus one, 0 means empty
+	u16 distances[capacity];
+	u32 count;
+
+	bool Find(u64 key, u32& index) const {
+		return RobinHood::Find(keys, distances, CAPACITY_BITS, key, index);
 	}
 public:
-	bool Add(u64 key, const T& value) {
-		if (key == UUID_NULL) {
-			return false;
+	class Iterator {
+		FixedHashMap* pMap;
+		u32 index;
+
+		void SkipEmpty() {
+			while (index < capacity && pMap->distances[index] == 0) {
+				index++;
+			}
+		}
+	public:
+		Iterator(FixedHashMap* pMap, u32 index) : pMap(pMap), index(index) {
+			SkipEmpty();
 		}
 
-		u32 hash = Hash(key);
+		FixedHashMapEntry<T> operator*() const {
+			return { pMap->keys[index], pMap->values[index] };
+		}
+		Iterator& operator++() {
+			index++;
+			SkipEmpty();
+			return *this;
+		}
+		bool operator!=(const Iterator& other) const {
+			return index != other.index;
+		}
+	};
 
-		if (Probe(key, hash)) {
+	bool Add(u64 key, const T& value) {
+		if (key == UUID_NULL || count >= MAX_COUNT) {
 			return false;
 		}
 
-		// Whole map is full
-		if (data[hash].key != UUID_NULL) {
+		u32 existing;
+		if (Find(key, existing)) {
 			return false;
 		}
 
-		data[hash] = {
-			.key = key,
-			.value = value
-		};
+		RobinHood::Insert(keys, values, distances, CAPACITY_BITS, key, value);
+		count++;
 
 		return true;
 	}
 	T* Get(u64 key) {
-		u32 hash;
-		if (GetHash(key, hash)) {
-			return &data[hash].value;
+		u32 index;
+		if (Find(key, index)) {
+			return &values[index];
 		}
 
 		return nullptr;
 	}
 	const T* Get(u64 key) const {
-		u32 hash;
-		if (GetHash(key, hash)) {
-			return &data[hash].value;
+		u32 index;
+		if (Find(key, index)) {
+			return &values[index];
 		}
 
 		return nullptr;
 	}
 	bool Remove(u64 key) {
-		if (key == UUID_NULL) {
+		u32 i;
+		if (!Find(key, i)) {
 			return false;
 		}
 
-		u32 hash = Hash(key);
+		RobinHood::RemoveAt(keys, values, distances, CAPACITY_BITS, i);
+		count--;
 
-		if (Probe(key, hash)) {
-			data[hash] = {
-			.key = UUID_NULL,
-			.value = T{}
-			};
-			return true;
-		}
-
-		return false;
+		return true;
 	}
 	void Clear() {
-		for (u32 i = 0; i < HASH_MAP_SIZE; i++) {
-			data[i].key = UUID_NULL;
-		}
+		memset(distances, 0, sizeof(distances));
+		count = 0;
+	}
+	u32 Count() const {
+		return count;
 	}
 	void ForEach(void (*callback) (u64, T&)) {
 		if (callback == nullptr) {
 			return;
 		}
 
-		for (u32 i = 0; i < HASH_MAP_SIZE; i++) {
-			TBucket& bucket = data[i];
-			if (bucket.key != UUID_NULL) {
-				callback(bucket.key, bucket.value);
-			}
+		for (FixedHashMapEntry<T> entry : *this) {
+			callback(entry.key, entry.value);
 		}
 	}
 
+	Iterator begin() {
+		return Iterator(this, 0);
+	}
+	Iterator end() {
+		return Iterator(this, capacity);
+	}
+
 	FixedHashMap() {
 		Clear();
 	}
-};
\ No newline at end of file
+};
+
+// FixedHashMap with runtime capacity allocated from an arena. Rehashes into arrays of twice the size when
+// the load gets too high; the old arrays stay in the arena until it's cleared
+template <typename T>
+class DynamicHashMap {
+private:
+	Arena* pArena;
+	u64* keys;
+	T* values;
+	u16* distances;
+	u32 capacityBits;
+	u32 count;
+
+	u32 Capacity() const {
+		return keys ? 1u << capacityBits : 0;
+	}
+	bool Find(u64 key, u32& index) const {
+		return keys && RobinHood::Find(keys, distances, capacityBits, key, index);
+	}
+public:
+	DynamicHashMap() : pArena(nullptr), keys(nullptr), values(nullptr), distances(nullptr), capacityBits(0), count(0) {}
+	DynamicHashMap(const DynamicHashMap& other) = delete;
+	DynamicHashMap& operator=(const DynamicHashMap& other) = delete;
+
+	void Init(Arena* arena, u32 initialCapacity) {
+		pArena = arena;
+		keys = nullptr;
+		values = nullptr;
+		distances = nullptr;
+		capacityBits = 0;
+		count = 0;
+		Reserve(initialCapacity);
+	}
+
+	// Makes room for at least minCount keys without rehashing
+	bool Reserve(u32 minCount) {
+		u32 newCapacity = std::bit_ceil(minCount + minCount / 7 + 1);
+		if (newCapacity < 16) {
+			newCapacity = 16;
+		}
+		if (newCapacity <= Capacity()) {
+			return true;
+		}
+
+		u64* newKeys = (u64*)pArena->Push(sizeof(u64) * newCapacity, alignof(u64), "DynamicHashMap");
+		T* newValues = (T*)pArena->Push(sizeof(T) * newCapacity, alignof(T), "DynamicHashMap");
+		u16* newDistances = (u16*)pArena->Push(sizeof(u16) * newCapacity, alignof(u16), "DynamicHashMap");
+		if (!newKeys || !newValues || !newDistances) {
+			return false;
+		}
+		memset(newDistances, 0, sizeof(u16) * newCapacity);
+
+		const u32 newCapacityBits = std::countr_zero(newCapacity);
+		const u32 oldCapacity = Capacity();
+		for (u32 i = 0; i < oldCapacity; i++) {
+			if (distances[i] != 0) {
+				RobinHood::Insert(newKeys, newValues, newDistances, newCapacityBits, keys[i], values[i]);
+			}
+		}
+
+		keys = newKeys;
+		values = newValues;
+		distances = newDistances;
+		capacityBits = newCapacityBits;
+		return true;
+	}
+
+	bool Add(u64 key, const T& value) {
+		u32 existing;
+		if (key == UUID_NULL || Find(key, existing)) {
+			return false;
+		}
+
+		// Same maximum load as FixedHashMap
+		const u32 capacity = Capacity();
+		if (count >= capacity - capacity / 8 && !Reserve(capacity)) {
+			return false;
+		}
+
+		RobinHood::Insert(keys, values, distances, capacityBits, key, value);
+		count++;
+		return true;
+	}
+	T* Get(u64 key) {
+		u32 index;
+		if (Find(key, index)) {
+			return &values[index];
+		}
+
+		return nullptr;
+	}
+	const T* Get(u64 key) const {
+		u32 index;
+		if (Find(key, index)) {
+			return &values[index];
+		}
+
+		return nullptr;
+	}
+	bool Remove(u64 key) {
+		u32 i;
+		if (!Find(key, i)) {
+			return false;
+		}
+
+		RobinHood::RemoveAt(keys, values, distances, capacityBits, i);
+		count--;
+		return true;
+	}
+	void Clear() {
+		if (distances) {
+			memset(distances, 0, sizeof(u16) * Capacity());
+		}
+		count = 0;
+	}
+	u32 Count() const {
+		return count;
+	}
+};
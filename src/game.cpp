@@ -4,6 +4,7 @@
 #include "game_rendering.h"
 #include "nes_timing.h"
 #include "asset_manager.h"
+#include "actor_commands.h"
 
 static GameConfig g_config;
 
@@ -49,7 +50,9 @@ namespace Game {
         LoadRoom(testDungeon, { 14, 14 });
     }
 
-    void Free() {}
+    void Free() {
+        FreeActorWorkers();
+    }
 
 	const GameConfig& GetConfig() {
 		return g_config;
@@ -165,8 +165,8 @@ static s16 RequestTileForDrawing(ChrBankHandle bankHandle, u8 tileIndex, TileDra
 static void InitVirtualCHR() {
     size_t chrBankCount;
     AssetManager::GetAllAssetInfosByType(ASSET_TYPE_CHR_BANK, chrBankCount, nullptr);
-    ArenaMarker scratchMarker = ArenaAllocator::GetMarker(ARENA_SCRATCH);
-    const AssetEntry** ppChrEntries = ArenaAllocator::PushArray<const AssetEntry*>(ARENA_SCRATCH, chrBankCount);
+    ScratchScope scratch;
+    const AssetEntry** ppChrEntries = scratch.PushArray<const AssetEntry*>(chrBankCount);
     AssetManager::GetAllAssetInfosByType(ASSET_TYPE_CHR_BANK, chrBankCount, ppChrEntries);
 
     for (size_t i = 0; i < chrBankCount; i++) {
@@ -188,8 +188,6 @@ static void InitVirtualCHR() {
             g_activePageTables[i].tiles[t] = -1;
         }
     }
-
-    ArenaAllocator::PopToMarker(ARENA_SCRATCH, scratchMarker);
 }
 #pragma endregion
 
@@ -497,6 +495,34 @@ bool Game::Rendering::DrawMetasprite(u8 layerIndex, MetaspriteHandle metaspriteH
     return true;
 }
 
+bool Game::Rendering::DrawMetaspriteBatch(u8 layerIndex, MetaspriteHandle metaspriteHandle, const glm::i16vec2* pPositions, u32 count, bool hFlip, bool vFlip, s32 paletteOverride) {
+    const Metasprite* pMetasprite = AssetManager::GetAsset(metaspriteHandle);
+    if (!pMetasprite) {
+        return false;
+    }
+
+    Sprite* outSprites = GetNextFreeSprite(layerIndex, pMetasprite->spriteCount * count);
+    if (outSprites == nullptr) {
+        return false;
+    }
+
+    // Tiles are the same for every instance, so only request them once
+    s16 tileIds[LAYER_SPRITE_COUNT];
+    for (u32 i = 0; i < pMetasprite->spriteCount; i++) {
+        tileIds[i] = RequestTileForDrawing(pMetasprite->chrBankHandle, pMetasprite->GetSprites()[i].tileId, TILE_DRAW_TYPE_FG);
+    }
+
+    for (u32 p = 0; p < count; p++) {
+        Sprite* pOut = outSprites + p * pMetasprite->spriteCount;
+        for (u32 i = 0; i < pMetasprite->spriteCount; i++) {
+            pOut[i] = TransformMetaspriteSprite(pMetasprite, i, pPositions[p], hFlip, vFlip, paletteOverride);
+            pOut[i].tileId = tileIds[i];
+        }
+    }
+
+    return true;
+}
+
 void Game::Rendering::DrawBackgroundTile(ChrBankHandle bankHandle, const BgTile& tile, const glm::ivec2& pos) {
 	s16 physicalTileIndex = RequestTileForDrawing(bankHandle, tile.tileId, TILE_DRAW_TYPE_BG);
 	if (physicalTileIndex < 0) {
@@ -556,6 +582,10 @@ void Game::Rendering::CopyLevelTileToNametable(const Tilemap* pTilemap, const gl
     const Tileset* pTileset = AssetManager::GetAsset(pTilemap->tilesetHandle);
 
     const s32 tilesetIndex = Tiles::GetTilesetTileIndex(pTilemap, worldPos);
+    if (tilesetIndex < 0) {
+        return;
+    }
+
     const TilesetTile& tile = pTileset->tiles[tilesetIndex];
 
     const Metatile& metatile = tile.metatile;
@@ -33,6 +33,8 @@ namespace Game {
 		bool DrawSprite(u8 layerIndex, ChrBankHandle bankHandle, const Sprite& sprite);
 		bool DrawMetaspriteSprite(u8 layerIndex, MetaspriteHandle metaspriteId, u32 spriteIndex, glm::i16vec2 pos, bool hFlip = false, bool vFlip = false, s32 paletteOverride = -1);
 		bool DrawMetasprite(u8 layerIndex, MetaspriteHandle metaspriteId, glm::i16vec2 pos, bool hFlip = false, bool vFlip = false, s32 paletteOverride = -1);
+		// Draws the same metasprite at several positions, resolving the asset and reserving layer sprites only once
+		bool DrawMetaspriteBatch(u8 layerIndex, MetaspriteHandle metaspriteId, const glm::i16vec2* pPositions, u32 count, bool hFlip = false, bool vFlip = false, s32 paletteOverride = -1);
 
 		void DrawBackgroundTile(ChrBankHandle bankHandle, const BgTile& tile, const glm::ivec2& pos);
 		void DrawBackgroundMetatile(ChrBankHandle bankHandle, const Metatile& metatile, const glm::ivec2& pos);
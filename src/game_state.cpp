@@ -8,7 +8,10 @@
 #include "collision.h"
 #include "asset_manager.h"
 #include "debug.h"
+#include "memory_arena.h"
 #include "actors.h"
+#include "actor_commands.h"
+#include "particles.h"
 #include "software_renderer.h"
 #include <cstring>
 
@@ -100,6 +103,18 @@ static const RoomInstance* GetDungeonRoom(DungeonHandle dungeonHandle, const glm
     return &result;
 }
 
+// Entering another dungeon prefetches its whole bundle, which is laid out to be read sequentially
+static void PrefetchRoomAssets(DungeonHandle dungeonHandle, const glm::i8vec2 gridCell) {
+    if (dungeonHandle != currentDungeonId && AssetManager::PrefetchBundle(dungeonHandle.id)) {
+        return;
+    }
+
+    const RoomInstance* pRoom = GetDungeonRoom(dungeonHandle, gridCell);
+    if (pRoom) {
+        AssetManager::PrefetchWithDependencies(pRoom->templateId.id);
+    }
+}
+
 static const glm::i8vec2 RoomPosToDungeonGridOffset(const glm::i8vec2& roomOffset, const glm::vec2 pos) {
     glm::i8vec2 gridOffset;
     gridOffset.x = roomOffset.x + s32(pos.x / VIEWPORT_WIDTH_METATILES);
@@ -267,12 +282,14 @@ static void StepDungeonGameplayFrame() {
         }
 		
         Game::UpdateActors();
+        Game::UpdateParticles();
         ViewportFollowPlayer();
         Game::UI::Update();
 	}
 
     Game::Rendering::ClearSpriteLayers();
     Game::DrawActors();
+    Game::DrawParticles();
 
     // Draw HUD
     Game::UI::DrawPlayerHealthBar(g_gameData.playerMaxHealth);
@@ -475,7 +492,7 @@ static void DrawMap(const glm::ivec2 scrollOffset) {
 
                 // Clipping: Check if tile is within worldTileBounds
                 if (xTile >= tileMin.x && xTile < tileMax.x) {
-                    const u32 roomTileIndex = (roomX * 2 + i) + roomY * ROOM_MAX_DIM_SCREENS * 2;
+                    const u32 roomTileIndex = (roomX * 2 + i) + roomY * roomWidthScreens * 2;
                     const BgTile& tile = pMapTiles[roomTileIndex];
                     Game::Rendering::DrawBackgroundTile(pTemplate->mapChrBankHandle, tile, {xTile, yTile});
                 }
@@ -669,6 +686,8 @@ enum LevelTransitionStatus : u8 {
     TRANSITION_COMPLETE
 };
 
+static constexpr u8 LEVEL_TRANSITION_HOLD_FRAMES = 12;
+
 struct LevelTransitionState {
     DungeonHandle nextDungeon;
     glm::i8vec2 nextGridCell;
@@ -677,7 +696,7 @@ struct LevelTransitionState {
 
     r32 progress = 0.0f;
     u8 status = TRANSITION_FADE_OUT;
-    u8 holdTimer = 12;
+    u8 holdTimer = LEVEL_TRANSITION_HOLD_FRAMES;
 };
 
 static void UpdateFadeToBlack(r32 progress, const u8* cachedColors) {
@@ -813,6 +832,10 @@ s16 Game::GetPlayerExp() {
     return g_gameData.playerExperience;
 }
 void Game::AddPlayerExp(s16 exp) {
+    if (ActorCommandsDeferred()) {
+        return PushActorCommand({ .type = ACTOR_COMMAND_ADD_EXP, .value = exp });
+    }
+
     g_gameData.playerExperience += exp;
     g_gameData.playerExperience = glm::clamp(g_gameData.playerExperience, s16(0), s16(SHRT_MAX));
 	Game::UI::SetPlayerDisplayExp(g_gameData.playerExperience);
@@ -882,12 +905,16 @@ void Game::SetPersistedActorData(u64 id, const PersistedActorData& data) {
         return;
     }
 
+    if (ActorCommandsDeferred()) {
+        return PushActorCommand({ .type = ACTOR_COMMAND_PERSIST_DATA, .id = id, .persistData = data });
+    }
+
     PersistedActorData* pPersistData = g_gameData.persistedActorData.Get(id);
     if (pPersistData) {
         *pPersistData = data;
     }
-    else {
-        g_gameData.persistedActorData.Add(id, data);
+    else if (!g_gameData.persistedActorData.Add(id, data)) {
+        DEBUG_ERROR("Persisted actor data is full, state of actor %llu is lost\n", id);
     }
 }
 #pragma endregion
@@ -936,6 +963,7 @@ bool Game::LoadOverworld(u8 keyAreaIndex, u8 direction) {
 
     Rendering::SetViewportPos(glm::vec2(0.0f), false);
     ClearActors();
+    ClearParticles();
 
     const OverworldKeyArea& area = pOverworld->keyAreas[keyAreaIndex];
     const glm::ivec2 overworldDir = GetOverworldDir(area, direction);
@@ -988,6 +1016,7 @@ void Game::UnloadRoom() {
     Rendering::SetViewportPos(glm::vec2(0.0f), false);
 
 	ClearActors();
+    ClearParticles();
 
     Rendering::RefreshViewport();
 }
@@ -1118,6 +1147,8 @@ void Game::InitGameState(GameState initialState) {
 }
 
 void Game::StepFrame() {
+    ArenaAllocator::Clear(ARENA_PER_FRAME);
+
     Input::Update();
     StepCoroutines();
 
@@ -1166,4 +1197,7 @@ void Game::TriggerLevelTransition(DungeonHandle targetDungeon, glm::i8vec2 targe
     };
     StartCoroutine(LevelTransitionCoroutine, state, callback);
     freezeGameplay = true;
+
+    // Paged in during the fade out
+    PrefetchRoomAssets(targetDungeon, targetGridCell);
 }
\ No newline at end of file
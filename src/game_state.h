@@ -22,6 +22,8 @@ struct PersistedActorData {
     bool activated : 1 = false;
 };
 
+static constexpr u32 MAX_PERSISTED_ACTOR_COUNT = 4096;
+
 struct GameData {
     s16 playerCurrentHealth;
     s16 playerMaxHealth;
@@ -34,7 +36,7 @@ struct GameData {
 
 	Checkpoint checkpoint;
     ExpRemnant expRemnant;
-    FixedHashMap<PersistedActorData> persistedActorData;
+    FixedHashMap<PersistedActorData, MAX_PERSISTED_ACTOR_COUNT> persistedActorData;
 };
 
 enum GameState {
@@ -6,6 +6,10 @@
 #include "game.h"
 #include "input.h"
 #include "audio.h"
+#include "software_renderer.h"
+#include "benchmark.h"
+#include <cstring>
+#include <cstdlib>
 #define GLM_FORCE_RADIANS
 #include <glm.hpp>
 
@@ -61,15 +65,40 @@ static void UpdateWindowTitle(SDL_Window* pWindow, r64 averageFramerate, r64 dt)
     SDL_SetWindowTitle(pWindow, titleStr);
 }
 
+static constexpr u32 DEFAULT_BENCHMARK_FRAME_COUNT = 300;
+
+// Runs without a window or audio device: pixelengine --benchmark [frameCount]
+static int RunHeadlessBenchmark(u32 frameCount) {
+    SDL_Init(SDL_INIT_TIMER | SDL_INIT_EVENTS);
+    Rendering::Software::Init();
+
+    Game::Initialize();
+    Benchmark::RunActorStress(frameCount);
+    ArenaAllocator::PrintStats();
+    Game::Free();
+
+    Rendering::Software::Free();
+    AssetManager::Free();
+    SDL_Quit();
+
+    ArenaAllocator::Free();
+    return 0;
+}
+
 int main(int argc, char** argv) {
 	ArenaAllocator::Init();
 
 #ifdef EDITOR
     Editor::Assets::LoadAssetsFromDirectory(ASSETS_SRC_DIR);
 #else
-    AssetManager::LoadArchive(ASSETS_NPAK_OUTPUT);
+    AssetManager::LoadArchive(ASSETS_NPAK_OUTPUT, true);
 #endif
 
+    if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+        const u32 frameCount = argc > 2 ? (u32)atoi(argv[2]) : DEFAULT_BENCHMARK_FRAME_COUNT;
+        return RunHeadlessBenchmark(frameCount);
+    }
+
     SDL_Init(SDL_INIT_TIMER | SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_JOYSTICK | SDL_INIT_GAMECONTROLLER | SDL_INIT_EVENTS | SDL_INIT_HAPTIC);
 
     u32 windowFlags = SDL_WINDOW_SHOWN;
@@ -141,6 +170,8 @@ int main(int argc, char** argv) {
 #endif
             Rendering::EndFrame();
         }
+
+        AssetManager::EndFrame();
     }
 
     Game::Free();
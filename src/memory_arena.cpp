@@ -1,18 +1,86 @@
+#ifdef PLATFORM_WINDOWS
+    #include <windows.h>
+#elif PLATFORM_LINUX
+    #include <sys/mman.h>
+#endif
+
 #include "memory_arena.h"
 #include "debug.h"
 #include <cstdlib>
 #include <cstring>
 #include <cassert>
+#include <cstdio>
+#include <thread>
 
 static constexpr size_t PERMANENT_ARENA_SIZE = 8 * 1024 * 1024; // 8 MB
 static constexpr size_t ASSET_ARENA_SIZE = 4 * 1024 * 1024; // 4 MB
 static constexpr size_t SCRATCH_ARENA_SIZE = 4 * 1024 * 1024; // 4 MB
+static constexpr size_t PER_FRAME_ARENA_SIZE = 1 * 1024 * 1024; // 1 MB
+static constexpr size_t THREAD_SCRATCH_ARENA_SIZE = 512 * 1024; // 512 KB per worker thread
+
+// Virtual memory arenas reserve address space up front and commit it as they grow, so the sizes above only apply to the malloc fallback
+static constexpr size_t VIRTUAL_ARENA_RESERVE_SIZE = 1024ull * 1024 * 1024; // 1 GB
+static constexpr size_t THREAD_SCRATCH_RESERVE_SIZE = 64ull * 1024 * 1024; // 64 MB
+static constexpr size_t COMMIT_GRANULARITY = 64 * 1024;
+static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+// Popping keeps up to this much committed above the current position, so arenas cleared every frame don't thrash
+static constexpr size_t DECOMMIT_THRESHOLD = 4 * 1024 * 1024;
+
+#ifdef ARENA_HUGE_PAGES
+static constexpr bool USE_HUGE_PAGES = true;
+#else
+static constexpr bool USE_HUGE_PAGES = false;
+#endif
 
 static Arena g_arenas[ARENA_COUNT];
 static bool g_initialized = false;
 
 static void* g_arenaMemory[ARENA_COUNT] = { nullptr };
 
+// Threads other than the one that called Init get their own scratch arena on first use
+static std::thread::id g_mainThreadId;
+
+static size_t AlignUp(size_t value, size_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Tries a virtual memory arena first and falls back to a fixed malloc block
+static void* AllocateArenaMemory(Arena& arena, size_t fixedSize, size_t reserveSize, const char* name) {
+#ifdef ARENA_VIRTUAL_MEMORY
+	void* pReserved = ArenaAllocator::ReserveVirtualMemory(reserveSize, USE_HUGE_PAGES);
+	if (pReserved) {
+		arena.InitVirtual(pReserved, reserveSize, name, USE_HUGE_PAGES);
+		return pReserved;
+	}
+	DEBUG_WARN("Failed to reserve %zu bytes for arena %s, using a fixed size block\n", reserveSize, name);
+#endif
+
+	void* pMemory = malloc(fixedSize);
+	if (pMemory) {
+		arena.Init(pMemory, fixedSize, name);
+	}
+	return pMemory;
+}
+
+static void FreeArenaMemory(const Arena& arena, void* pMemory) {
+	if (arena.IsVirtual()) {
+		ArenaAllocator::ReleaseVirtualMemory(pMemory, arena.Capacity());
+	}
+	else free(pMemory);
+}
+
+struct ThreadScratchArena {
+	Arena arena;
+	void* pMemory = nullptr;
+
+	~ThreadScratchArena() {
+		if (pMemory) {
+			FreeArenaMemory(arena, pMemory);
+		}
+	}
+};
+static thread_local ThreadScratchArena t_scratchArena;
+
 void ArenaAllocator::Init() {
     if (g_initialized) {
 		DEBUG_WARN("Memory arenas already initialized.\n");
@@ -23,7 +91,8 @@ void ArenaAllocator::Init() {
     constexpr size_t arenaSizes[ARENA_COUNT] = {
 		PERMANENT_ARENA_SIZE,
 		ASSET_ARENA_SIZE,
-		SCRATCH_ARENA_SIZE
+		SCRATCH_ARENA_SIZE,
+		PER_FRAME_ARENA_SIZE,
     };
 
     // Arena names for debugging
@@ -31,18 +100,19 @@ void ArenaAllocator::Init() {
 		"Permanent",
 		"Assets",
         "Scratch",
+		"Per frame",
     };
 
     for (u32 i = 0; i < ARENA_COUNT; i++) {
-		g_arenaMemory[i] = malloc(arenaSizes[i]);
+		g_arenaMemory[i] = AllocateArenaMemory(g_arenas[i], arenaSizes[i], VIRTUAL_ARENA_RESERVE_SIZE, arenaNames[i]);
 		if (!g_arenaMemory[i]) {
 			DEBUG_FATAL("Failed to allocate memory for arena %s (%zu bytes)\n", arenaNames[i], arenaSizes[i]);
 			return;
 		}
-		g_arenas[i].Init(g_arenaMemory[i], arenaSizes[i], arenaNames[i]);
-		DEBUG_LOG("Initialized arena %s with size %zu bytes\n", arenaNames[i], arenaSizes[i]);
+		DEBUG_LOG("Initialized arena %s with size %zu bytes\n", arenaNames[i], g_arenas[i].Capacity());
     }
 
+	g_mainThreadId = std::this_thread::get_id();
 	g_initialized = true;
 	DEBUG_LOG("Memory arenas initialized successfully.\n");
 }
@@ -54,7 +124,7 @@ void ArenaAllocator::Free() {
 
 	for (u32 i = 0; i < ARENA_COUNT; i++) {
 		if (g_arenaMemory[i]) {
-			free(g_arenaMemory[i]);
+			FreeArenaMemory(g_arenas[i], g_arenaMemory[i]);
 			g_arenaMemory[i] = nullptr;
 		}
 
@@ -79,14 +149,14 @@ Arena* ArenaAllocator::GetArena(ArenaType type) {
 	return &g_arenas[type];
 }
 
-void* ArenaAllocator::Push(ArenaType type, size_t bytes, size_t alignment) {
+void* ArenaAllocator::Push(ArenaType type, size_t bytes, size_t alignment, const char* tag) {
 	Arena* pArena = GetArena(type);
 	if (!pArena) {
 		DEBUG_ERROR("Failed to get arena for type %d\n", type);
 		return nullptr;
 	}
 
-	void* pResult = pArena->Push(bytes, alignment);
+	void* pResult = pArena->Push(bytes, alignment, tag);
 	if (!pResult) {
 		DEBUG_ERROR("Failed to allocate %zu bytes in arena %s\n", bytes, pArena->Name());
 		return nullptr;
@@ -149,6 +219,180 @@ bool ArenaAllocator::Copy(const ArenaMarker& dstMarker, const ArenaMarker& srcMa
 		return false;
 	}
 
+	// The destination may be past the current position of a virtual memory arena
+	Arena* pDstArena = const_cast<Arena*>(dstMarker.pArena);
+	if (!pDstArena->EnsureCommitted(dstMarker.position + bytes)) {
+		DEBUG_ERROR("Failed to commit memory in destination arena to copy %zu bytes\n", bytes);
+		return false;
+	}
+
 	memcpy(dstMarker.position, srcMarker.position, bytes);
 	return true;
-}
\ No newline at end of file
+}
+
+ArenaStats ArenaAllocator::GetStats(ArenaType type) {
+	Arena* pArena = GetArena(type);
+	if (!pArena) {
+		DEBUG_ERROR("Failed to get arena for type %d\n", type);
+		return ArenaStats{};
+	}
+
+	return pArena->GetStats();
+}
+
+static void PrintArenaStats(const Arena* pArena) {
+	const ArenaStats stats = pArena->GetStats();
+#ifdef ARENA_STATS
+	printf("%-10s %10zu / %-10zu committed %10zu, high water %10zu (%5.1f%%), %u allocations, %zu bytes padding, %u failed\n",
+		pArena->Name(),
+		stats.size,
+		stats.capacity,
+		stats.committed,
+		stats.highWater,
+		stats.capacity ? 100.0 * stats.highWater / stats.capacity : 0.0,
+		stats.allocationCount,
+		stats.paddingBytes,
+		stats.failedAllocationCount);
+
+	for (u32 i = 0; i < stats.tagCount; i++) {
+		const ArenaTagStats& tag = stats.tags[i];
+		printf("    %10zu bytes in %6u allocations  %s\n", tag.bytes, tag.count, tag.tag);
+	}
+#else
+	printf("%-10s %10zu / %-10zu committed %10zu\n", pArena->Name(), stats.size, stats.capacity, stats.committed);
+#endif
+}
+
+void ArenaAllocator::PrintStats() {
+	if (!g_initialized) {
+		return;
+	}
+
+	printf("Arena usage in bytes\n");
+	for (u32 i = 0; i < ARENA_COUNT; i++) {
+		PrintArenaStats(&g_arenas[i]);
+	}
+}
+
+void ArenaAllocator::ReportOverflow(const Arena* pArena, size_t bytes, size_t alignment, const char* tag) {
+	// Printed even in release builds, an overflow is about to crash or fail an allocation
+	printf("Arena overflow in %s: %zu bytes (alignment %zu) requested by %s, %zu of %zu bytes remaining\n",
+		pArena->Name(),
+		bytes,
+		alignment,
+		tag ? tag : "(untagged)",
+		pArena->GetRemainingBytes(),
+		pArena->GetStats().capacity);
+	PrintArenaStats(pArena);
+}
+
+Arena* ArenaAllocator::GetThreadScratch() {
+	if (std::this_thread::get_id() == g_mainThreadId) {
+		return GetArena(ARENA_SCRATCH);
+	}
+
+	ThreadScratchArena& scratch = t_scratchArena;
+	if (scratch.pMemory == nullptr) {
+		scratch.pMemory = AllocateArenaMemory(scratch.arena, THREAD_SCRATCH_ARENA_SIZE, THREAD_SCRATCH_RESERVE_SIZE, "Thread scratch");
+		if (!scratch.pMemory) {
+			DEBUG_FATAL("Failed to allocate thread scratch arena (%zu bytes)\n", THREAD_SCRATCH_ARENA_SIZE);
+			return nullptr;
+		}
+	}
+
+	return &scratch.arena;
+}
+
+#pragma region Virtual memory
+void* ArenaAllocator::ReserveVirtualMemory(size_t bytes, bool hugePages) {
+#ifdef PLATFORM_WINDOWS
+	// Large pages need a special privilege on Windows, so they're not used
+	return VirtualAlloc(nullptr, bytes, MEM_RESERVE, PAGE_NOACCESS);
+#elif PLATFORM_LINUX
+	// Over-reserve so the range can be aligned for transparent huge pages
+	const size_t slack = hugePages ? HUGE_PAGE_SIZE : 0;
+	u8* pReserved = (u8*)mmap(nullptr, bytes + slack, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (pReserved == MAP_FAILED) {
+		return nullptr;
+	}
+
+	if (hugePages) {
+		u8* pAligned = (u8*)AlignUp((uintptr_t)pReserved, HUGE_PAGE_SIZE);
+		if (pAligned > pReserved) {
+			munmap(pReserved, pAligned - pReserved);
+		}
+		const size_t tail = (pReserved + bytes + slack) - (pAligned + bytes);
+		if (tail > 0) {
+			munmap(pAligned + bytes, tail);
+		}
+		pReserved = pAligned;
+
+		if (madvise(pReserved, bytes, MADV_HUGEPAGE) != 0) {
+			DEBUG_WARN("Transparent huge pages not available\n");
+		}
+	}
+
+	return pReserved;
+#else
+	return nullptr;
+#endif
+}
+
+void ArenaAllocator::ReleaseVirtualMemory(void* memory, size_t bytes) {
+#ifdef PLATFORM_WINDOWS
+	VirtualFree(memory, 0, MEM_RELEASE);
+#elif PLATFORM_LINUX
+	munmap(memory, bytes);
+#endif
+}
+
+bool Arena::Commit(const u8* until) {
+	if (!virtualMemory || until > end) {
+		return false;
+	}
+
+	const size_t granularity = hugePages ? HUGE_PAGE_SIZE : COMMIT_GRANULARITY;
+	u8* newCommitted = data + AlignUp(until - data, granularity);
+	if (newCommitted > end) {
+		newCommitted = end;
+	}
+	const size_t bytes = newCommitted - committed;
+
+#ifdef PLATFORM_WINDOWS
+	if (!VirtualAlloc(committed, bytes, MEM_COMMIT, PAGE_READWRITE)) {
+		return false;
+	}
+#elif PLATFORM_LINUX
+	if (mprotect(committed, bytes, PROT_READ | PROT_WRITE) != 0) {
+		return false;
+	}
+#ifdef MADV_POPULATE_WRITE
+	// Fault the chunk in with one call instead of page by page on first touch
+	madvise(committed, bytes, MADV_POPULATE_WRITE);
+#endif
+#else
+	return false;
+#endif
+
+	committed = newCommitted;
+	return true;
+}
+
+void Arena::DecommitUnused() {
+	const size_t granularity = hugePages ? HUGE_PAGE_SIZE : COMMIT_GRANULARITY;
+	u8* keep = data + AlignUp((current - data) + DECOMMIT_THRESHOLD, granularity);
+	if (keep >= committed) {
+		return;
+	}
+	const size_t bytes = committed - keep;
+
+#ifdef PLATFORM_WINDOWS
+	VirtualFree(keep, bytes, MEM_DECOMMIT);
+#elif PLATFORM_LINUX
+	madvise(keep, bytes, MADV_DONTNEED);
+	mprotect(keep, bytes, PROT_NONE);
+#endif
+
+	committed = keep;
+}
+#pragma endregion
@@ -3,9 +3,43 @@
 #include <cassert>
 #include <type_traits>
 #include <cstring>
+#include <source_location>
+
+// Tags allocations with the calling function when no tag is given
+#define ARENA_CALLER std::source_location::current().function_name()
 
 class Arena;
 
+#ifdef ARENA_STATS
+constexpr u32 MAX_ARENA_TAG_COUNT = 32;
+
+// Cumulative, popped allocations aren't subtracted
+struct ArenaTagStats {
+	const char* tag;
+	size_t bytes;
+	u32 count;
+};
+#endif
+
+struct ArenaStats {
+	size_t capacity;
+	size_t size;
+	size_t committed; // Equal to capacity unless the arena is backed by reserved virtual memory
+#ifdef ARENA_STATS
+	size_t highWater;
+	size_t paddingBytes; // Lost to alignment
+	u32 allocationCount;
+	u32 failedAllocationCount;
+	u32 tagCount;
+	// When full, the remaining tags are counted under the last entry
+	ArenaTagStats tags[MAX_ARENA_TAG_COUNT];
+#endif
+};
+
+namespace ArenaAllocator {
+	void ReportOverflow(const Arena* pArena, size_t bytes, size_t alignment, const char* tag);
+}
+
 struct ArenaMarker {
 	u8* position;
 	const Arena* const pArena;
@@ -19,35 +53,116 @@ private:
 	u8* data;
 	u8* current;
 	u8* end;
+	// Pages past this are reserved but not backed by memory yet
+	u8* committed;
 	size_t capacity;
 	size_t size;
 	const char* name;
+	bool virtualMemory;
+	bool hugePages;
+
+	// Defined in memory_arena.cpp, only called for virtual memory arenas
+	bool Commit(const u8* until);
+	void DecommitUnused();
+#ifdef ARENA_STATS
+	ArenaStats stats;
+
+	void RecordTag(const char* tag, size_t bytes) {
+		if (tag == nullptr) {
+			tag = "(untagged)";
+		}
+
+		u32 i = 0;
+		for (; i < stats.tagCount; i++) {
+			const char* existing = stats.tags[i].tag;
+			if (existing == tag || strcmp(existing, tag) == 0) {
+				break;
+			}
+		}
+
+		if (i == stats.tagCount) {
+			if (stats.tagCount < MAX_ARENA_TAG_COUNT) {
+				stats.tags[stats.tagCount++] = { tag, 0, 0 };
+			}
+			else {
+				i = MAX_ARENA_TAG_COUNT - 1;
+				stats.tags[i].tag = "(other)";
+			}
+		}
+
+		stats.tags[i].bytes += bytes;
+		stats.tags[i].count++;
+	}
+#endif
 
 public:
-	Arena() : data(nullptr), current(nullptr), end(nullptr), capacity(0), size(0), name("Unnamed") {}
+	Arena() : data(nullptr), current(nullptr), end(nullptr), committed(nullptr), capacity(0), size(0), name("Unnamed"), virtualMemory(false), hugePages(false) {
+#ifdef ARENA_STATS
+		stats = {};
+#endif
+	}
 
 	void Init(void* memory, size_t totalSize, const char* arenaName) {
 		data = static_cast<u8*>(memory);
 		current = data;
 		end = data + totalSize;
+		committed = end;
 		capacity = totalSize;
 		size = 0;
 		name = arenaName;
+		virtualMemory = false;
+		hugePages = false;
+#ifdef ARENA_STATS
+		stats = {};
+#endif
+	}
+
+	// Memory must be reserved with ArenaAllocator::ReserveVirtualMemory. Pages are committed as the arena grows
+	void InitVirtual(void* reserved, size_t reserveSize, const char* arenaName, bool useHugePages) {
+		Init(reserved, reserveSize, arenaName);
+		committed = data;
+		virtualMemory = true;
+		hugePages = useHugePages;
 	}
 
-	void* Push(size_t bytes, size_t alignment = sizeof(void*)) {
+	bool IsVirtual() const {
+		return virtualMemory;
+	}
+
+	// Makes sure memory up to the given position can be written to, for writes past the current position
+	bool EnsureCommitted(const u8* until) {
+		return until <= committed || Commit(until);
+	}
+
+	void* Push(size_t bytes, size_t alignment = sizeof(void*), const char* tag = nullptr) {
 		uintptr_t aligned = (reinterpret_cast<uintptr_t>(current) + alignment - 1) & ~(alignment - 1);
 		u8* alignedPtr = reinterpret_cast<u8*>(aligned);
 
-		if (alignedPtr + bytes > end) {
+		if (alignedPtr + bytes > end || !EnsureCommitted(alignedPtr + bytes)) {
+#ifdef ARENA_STATS
+			stats.failedAllocationCount++;
+#endif
+			ArenaAllocator::ReportOverflow(this, bytes, alignment, tag);
 			assert(false && "Arena overflow");
 			return nullptr;
 		}
 
+#ifdef ARENA_STATS
+		stats.paddingBytes += alignedPtr - current;
+		stats.allocationCount++;
+		RecordTag(tag, bytes);
+#endif
+
 		void* pResult = alignedPtr;
 		current = alignedPtr + bytes;
 		size = current - data;
 
+#ifdef ARENA_STATS
+		if (size > stats.highWater) {
+			stats.highWater = size;
+		}
+#endif
+
 		return pResult;
 	}
 
@@ -68,6 +183,10 @@ public:
 		}
 		current -= bytes;
 		size = current - data;
+
+		if (virtualMemory) {
+			DecommitUnused();
+		}
 	}
 
 	ArenaMarker GetMarker() const {
@@ -85,12 +204,20 @@ public:
 		size_t bytesToPop = current - marker.position;
 		current = marker.position;
 		size = current - data;
+
+		if (virtualMemory) {
+			DecommitUnused();
+		}
 		return bytesToPop;
 	}
 
 	void Clear() {
 		current = data;
 		size = 0;
+
+		if (virtualMemory) {
+			DecommitUnused();
+		}
 	}
 
 	size_t GetRemainingBytes() const {
@@ -108,16 +235,32 @@ public:
 		return size;
 	}
 
+	size_t Capacity() const {
+		return capacity;
+	}
+
 	const char* Name() const {
 		return name;
 	}
+
+	ArenaStats GetStats() const {
+#ifdef ARENA_STATS
+		ArenaStats result = stats;
+#else
+		ArenaStats result{};
+#endif
+		result.capacity = capacity;
+		result.size = size;
+		result.committed = committed - data;
+		return result;
+	}
 };
 
 enum ArenaType {
 	ARENA_PERMANENT,
 	ARENA_ASSETS,
 	ARENA_SCRATCH,
-	// ARENA_PER_FRAME, // Uncomment if needed for per-frame allocations
+	ARENA_PER_FRAME, // Cleared at the start of every game frame
 
 	ARENA_COUNT
 };
@@ -128,7 +271,7 @@ namespace ArenaAllocator {
 
 	Arena* GetArena(ArenaType type);
 
-	void* Push(ArenaType type, size_t bytes, size_t alignment = sizeof(void*));
+	void* Push(ArenaType type, size_t bytes, size_t alignment = sizeof(void*), const char* tag = ARENA_CALLER);
 	template <typename T, typename... Args>
 	T* Push(ArenaType type, Args&&... args) {
 		static_assert(std::is_trivially_destructible<T>::value, "Type must be trivially destructible");
@@ -139,9 +282,9 @@ namespace ArenaAllocator {
 		return new (pResult) T(args...);
 	}
 	template<typename T>
-	T* PushArray(ArenaType type, size_t count) {
+	T* PushArray(ArenaType type, size_t count, const char* tag = ARENA_CALLER) {
 		static_assert(std::is_trivially_destructible<T>::value, "Type must be trivially destructible");
-		void* pResult = Push(type, sizeof(T) * count, alignof(T));
+		void* pResult = Push(type, sizeof(T) * count, alignof(T), tag);
 		if (pResult == nullptr) {
 			return nullptr;
 		}
@@ -163,4 +306,54 @@ namespace ArenaAllocator {
 	void PopToMarker(ArenaType type, const ArenaMarker& marker);
 	void Clear(ArenaType type);
 	bool Copy(const ArenaMarker& dstMarker, const ArenaMarker& srcMarker, size_t bytes);
-}
\ No newline at end of file
+
+	ArenaStats GetStats(ArenaType type);
+	// Prints usage and per-tag stats of every arena to stdout
+	void PrintStats();
+
+	// ARENA_SCRATCH on the main thread, a lazily allocated arena of its own on any other thread
+	Arena* GetThreadScratch();
+
+	// Reserves address space without committing memory, returns nullptr where virtual memory isn't supported
+	void* ReserveVirtualMemory(size_t bytes, bool hugePages);
+	void ReleaseVirtualMemory(void* memory, size_t bytes);
+}
+
+// Allocates from the calling thread's scratch arena and pops back to where it started when it goes out of scope
+class ScratchScope {
+private:
+	Arena* pArena;
+	ArenaMarker marker;
+
+public:
+	ScratchScope() : pArena(ArenaAllocator::GetThreadScratch()), marker(pArena->GetMarker()) {}
+	~ScratchScope() {
+		pArena->PopToMarker(marker);
+	}
+	ScratchScope(const ScratchScope&) = delete;
+	ScratchScope& operator=(const ScratchScope&) = delete;
+
+	void* Push(size_t bytes, size_t alignment = sizeof(void*), const char* tag = ARENA_CALLER) {
+		return pArena->Push(bytes, alignment, tag);
+	}
+	template<typename T>
+	T* PushArray(size_t count, const char* tag = ARENA_CALLER) {
+		static_assert(std::is_trivially_destructible<T>::value, "Type must be trivially destructible");
+		T* arr = static_cast<T*>(pArena->Push(sizeof(T) * count, alignof(T), tag));
+		if (arr == nullptr) {
+			return nullptr;
+		}
+		if constexpr (std::is_trivial<T>::value) {
+			memset(arr, 0, sizeof(T) * count);
+		}
+		else {
+			for (size_t i = 0; i < count; ++i) {
+				new (&arr[i]) T();
+			}
+		}
+		return arr;
+	}
+	Arena* GetArena() const {
+		return pArena;
+	}
+};
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "typedef.h"
+#include "memory_arena.h"
 #include <algorithm>
 
 template <typename T>
@@ -37,6 +38,234 @@ public:
 	}
 };
 
+// Dense iteration over the live objects of a pool, in handle order.
+// The end is checked against the current count, so objects added during iteration are visited too
+struct PoolIteratorEnd {};
+
+template<typename TPool, typename TObj>
+class PoolIterator {
+	TPool* pPool;
+	u32 index;
+public:
+	PoolIterator(TPool* pPool, u32 index) : pPool(pPool), index(index) {}
+
+	TObj& operator*() const {
+		return pPool->GetDense(index);
+	}
+	TObj* operator->() const {
+		return &pPool->GetDense(index);
+	}
+	PoolIterator& operator++() {
+		index++;
+		return *this;
+	}
+	bool operator!=(PoolIteratorEnd) const {
+		return index < pPool->Count();
+	}
+	bool operator==(PoolIteratorEnd) const {
+		return index >= pPool->Count();
+	}
+};
+
+// Sorting shared by Pool and DynamicPool. The sorts only move handles, the erase mapping is fixed up once at the end
+namespace PoolSort {
+	static constexpr u32 INSERTION_SORT_THRESHOLD = 16;
+
+	template<typename T, typename THandle, typename CompareFunc>
+	inline bool Less(const T* objs, const THandle* handles, u32 a, u32 b, CompareFunc compare) {
+		return compare(objs[handles[a].Index()], objs[handles[b].Index()]);
+	}
+
+	template<typename THandle>
+	inline void SwapHandles(THandle* handles, u32 a, u32 b) {
+		const THandle temp = handles[a];
+		handles[a] = handles[b];
+		handles[b] = temp;
+	}
+
+	template<typename THandle>
+	void RebuildErase(const THandle* handles, u32* erase, u32 begin, u32 end) {
+		for (u32 i = begin; i < end; i++) {
+			erase[handles[i].Index()] = i;
+		}
+	}
+
+	template<typename T, typename THandle, typename CompareFunc>
+	u32 Partition(const T* objs, THandle* handles, u32 begin, u32 end, CompareFunc compare) {
+		// Move the median of the first, middle and last objects to the last position and use it as pivot
+		const u32 last = end - 1;
+		const u32 mid = begin + (end - begin) / 2;
+		if (Less(objs, handles, mid, begin, compare)) SwapHandles(handles, mid, begin);
+		if (Less(objs, handles, last, begin, compare)) SwapHandles(handles, last, begin);
+		if (Less(objs, handles, mid, last, compare)) SwapHandles(handles, mid, last);
+
+		const T& pivot = objs[handles[last].Index()];
+		u32 i = begin;
+
+		for (u32 j = begin; j < last; j++) {
+			const T& current = objs[handles[j].Index()];
+			if (compare(current, pivot)) {
+				SwapHandles(handles, i, j);
+				i++;
+			}
+		}
+		SwapHandles(handles, i, last);
+		return i;
+	}
+
+	template<typename T, typename THandle, typename CompareFunc>
+	void InsertionSort(const T* objs, THandle* handles, u32 begin, u32 end, CompareFunc compare) {
+		for (u32 i = begin + 1; i < end; i++) {
+			const THandle handle = handles[i];
+			const T& current = objs[handle.Index()];
+
+			u32 j = i;
+			while (j > begin && compare(current, objs[handles[j - 1].Index()])) {
+				handles[j] = handles[j - 1];
+				j--;
+			}
+			handles[j] = handle;
+		}
+	}
+
+	template<typename T, typename THandle, typename CompareFunc>
+	void SiftDown(const T* objs, THandle* handles, u32 begin, u32 root, u32 size, CompareFunc compare) {
+		while (true) {
+			u32 largest = root;
+			const u32 left = 2 * root + 1;
+			const u32 right = left + 1;
+			if (left < size && Less(objs, handles, begin + largest, begin + left, compare)) largest = left;
+			if (right < size && Less(objs, handles, begin + largest, begin + right, compare)) largest = right;
+			if (largest == root) {
+				return;
+			}
+
+			SwapHandles(handles, begin + root, begin + largest);
+			root = largest;
+		}
+	}
+
+	template<typename T, typename THandle, typename CompareFunc>
+	void HeapSort(const T* objs, THandle* handles, u32 begin, u32 end, CompareFunc compare) {
+		const u32 size = end - begin;
+		for (u32 i = size / 2; i > 0; i--) {
+			SiftDown(objs, handles, begin, i - 1, size, compare);
+		}
+
+		for (u32 i = size - 1; i > 0; i--) {
+			SwapHandles(handles, begin, begin + i);
+			SiftDown(objs, handles, begin, 0, i, compare);
+		}
+	}
+
+	// Sorts the range [begin, end)
+	template<typename T, typename THandle, typename CompareFunc>
+	void IntroSort(const T* objs, THandle* handles, u32 begin, u32 end, u32 depthLimit, CompareFunc compare) {
+		while (end - begin > INSERTION_SORT_THRESHOLD) {
+			if (depthLimit == 0) {
+				HeapSort(objs, handles, begin, end, compare);
+				return;
+			}
+			depthLimit--;
+
+			// Recurse into the smaller side to keep the stack depth logarithmic
+			const u32 pivot = Partition(objs, handles, begin, end, compare);
+			if (pivot - begin < end - pivot) {
+				IntroSort(objs, handles, begin, pivot, depthLimit, compare);
+				begin = pivot + 1;
+			}
+			else {
+				IntroSort(objs, handles, pivot + 1, end, depthLimit, compare);
+				end = pivot;
+			}
+		}
+
+		InsertionSort(objs, handles, begin, end, compare);
+	}
+
+	template<typename T, typename THandle, typename CompareFunc>
+	void Sort(const T* objs, THandle* handles, u32 count, CompareFunc compare) {
+		if (count <= 1) return;
+
+		// Fall back to heapsort after 2 * log2(n) levels of bad pivots
+		u32 depthLimit = 0;
+		for (u32 n = count; n > 1; n >>= 1) {
+			depthLimit += 2;
+		}
+
+		IntroSort(objs, handles, 0, count, depthLimit, compare);
+	}
+
+	// Key and handle buffers must hold count elements each
+	template<typename T, typename THandle, typename KeyFunc>
+	void RadixSortByKey(const T* objs, THandle* handles, u32 count, KeyFunc getKey, u64* pKeys, u64* pTempKeys, THandle* pTempHandles) {
+		THandle* pHandles = handles;
+
+		u32 histograms[sizeof(u64)][256] = {};
+		for (u32 i = 0; i < count; i++) {
+			const u64 key = getKey(objs[handles[i].Index()]);
+			pKeys[i] = key;
+			for (u32 b = 0; b < sizeof(u64); b++) {
+				histograms[b][(key >> (b * 8)) & 0xFF]++;
+			}
+		}
+
+		for (u32 b = 0; b < sizeof(u64); b++) {
+			const u32 shift = b * 8;
+			u32* histogram = histograms[b];
+			if (histogram[(pKeys[0] >> shift) & 0xFF] == count) {
+				continue;
+			}
+
+			u32 offset = 0;
+			for (u32 d = 0; d < 256; d++) {
+				const u32 digitCount = histogram[d];
+				histogram[d] = offset;
+				offset += digitCount;
+			}
+
+			for (u32 i = 0; i < count; i++) {
+				const u32 dst = histogram[(pKeys[i] >> shift) & 0xFF]++;
+				pTempKeys[dst] = pKeys[i];
+				pTempHandles[dst] = pHandles[i];
+			}
+
+			std::swap(pKeys, pTempKeys);
+			std::swap(pHandles, pTempHandles);
+		}
+
+		if (pHandles != handles) {
+			std::copy(pHandles, pHandles + count, handles);
+		}
+	}
+
+	// Moves the last handle to its sorted position, the rest must already be sorted. Returns the new position
+	template<typename T, typename THandle, typename CompareFunc>
+	u32 MoveToSortedPosition(const T* objs, THandle* handles, u32 count, CompareFunc compare) {
+		const THandle handle = handles[count - 1];
+		const T& obj = objs[handle.Index()];
+
+		// Upper bound, so equal objects stay in insertion order
+		u32 left = 0;
+		u32 right = count - 1;
+		while (left < right) {
+			const u32 mid = left + (right - left) / 2;
+			if (compare(obj, objs[handles[mid].Index()])) {
+				right = mid;
+			}
+			else {
+				left = mid + 1;
+			}
+		}
+
+		for (u32 i = count - 1; i > left; i--) {
+			handles[i] = handles[i - 1];
+		}
+		handles[left] = handle;
+		return left;
+	}
+}
+
 template<typename T, u32 capacity, typename THandle = PoolHandle<T>>
 class Pool
 {
@@ -46,6 +275,21 @@ private:
 	u32 erase[capacity];
 
 	u32 count;
+	// Handles below this index were live before the last Clear and get a new generation when reused
+	u32 staleCount;
+
+	void CopyLive(const Pool& other) {
+		count = other.count;
+		staleCount = other.staleCount;
+
+		// Only live objects are copied, the handle and erase arrays are small compared to the objects
+		std::copy(other.handles, other.handles + capacity, handles);
+		std::copy(other.erase, other.erase + capacity, erase);
+		for (u32 i = 0; i < count; i++) {
+			const u32 arrayIndex = handles[i].Index();
+			objs[arrayIndex] = other.objs[arrayIndex];
+		}
+	}
 
 	bool GetArrayIndex(const THandle handle, u32& index) const {
 		if (handle == THandle::Null()) {
@@ -69,6 +313,7 @@ private:
 public:
 	Pool() {
 		count = 0;
+		staleCount = 0;
 
 		for (u32 i = 0; i < capacity; i++)
 		{
@@ -77,18 +322,10 @@ public:
 		}
 	}
 	Pool(const Pool& other) {
-		count = other.count;
-
-		std::copy(other.objs, other.objs + capacity, objs);
-		std::copy(other.handles, other.handles + capacity, handles);
-		std::copy(other.erase, other.erase + capacity, erase);
+		CopyLive(other);
 	}
 	Pool(Pool&& other) noexcept {
-		count = other.count;
-
-		std::copy(other.objs, other.objs + capacity, objs);
-		std::copy(other.handles, other.handles + capacity, handles);
-		std::copy(other.erase, other.erase + capacity, erase);
+		CopyLive(other);
 
 		other.Clear();
 	}
@@ -115,7 +352,16 @@ public:
 		if (count >= capacity) {
 			return THandle::Null();
 		}
-		THandle handle = handles[count++];
+
+		THandle handle = handles[count];
+		if (count < staleCount) {
+			handle = THandle(handle.Index(), handle.Generation() + 1);
+			handles[count] = handle;
+		}
+
+		if (++count >= staleCount) {
+			staleCount = 0;
+		}
 		return handle;
 	}
 	THandle Add(const T& proto) {
@@ -128,8 +374,11 @@ public:
     bool Remove(const THandle handle) {
 		const u32 arrayIndex = handle.Index();
 		const u32 handleIndex = erase[arrayIndex];
-		const THandle h = handles[handleIndex];
+		if (handleIndex >= count) {
+			return false;
+		}
 
+		const THandle h = handles[handleIndex];
 		if (h != handle) {
 			return false;
 		}
@@ -160,31 +409,40 @@ public:
 		}
 		return handles[index];
 	}
+	// Dense access without a generation check, index must be less than Count()
+	T& GetDense(u32 index) {
+		return objs[handles[index].Index()];
+	}
+	const T& GetDense(u32 index) const {
+		return objs[handles[index].Index()];
+	}
+	PoolIterator<Pool, T> begin() {
+		return PoolIterator<Pool, T>(this, 0);
+	}
+	PoolIterator<const Pool, const T> begin() const {
+		return PoolIterator<const Pool, const T>(this, 0);
+	}
+	PoolIteratorEnd end() const {
+		return PoolIteratorEnd{};
+	}
 	void Clear() {
-		while (count != 0) {
-			THandle handle = GetHandle(0);
-			Remove(handle);
+		// Generations are bumped lazily in Add
+		if (count > staleCount) {
+			staleCount = count;
 		}
+		count = 0;
 	}
 
 	Pool& operator=(const Pool& other) {
 		if (this != &other) {  // Prevent self-assignment
-			count = other.count;
-
-			std::copy(other.objs, other.objs + capacity, objs);
-			std::copy(other.handles, other.handles + capacity, handles);
-			std::copy(other.erase, other.erase + capacity, erase);
+			CopyLive(other);
 		}
 		return *this;
 	}
 
 	Pool& operator=(Pool&& other) noexcept {
 		if (this != &other) {
-			count = other.count;
-
-			std::copy(other.objs, other.objs + capacity, objs);
-			std::copy(other.handles, other.handles + capacity, handles);
-			std::copy(other.erase, other.erase + capacity, erase);
+			CopyLive(other);
 
 			// Clear source
 			other.Clear();
@@ -192,7 +450,7 @@ public:
 		return *this;
 	}
 
-	// Sort the pool contents using quicksort with a comparison function
+	// Sort the pool contents using introsort with a comparison function
 	// The comparison function should return true if the first argument should come before the second
 	// 
 	// Example usage:
@@ -204,48 +462,281 @@ public:
 	//   actors.Sort([](const Actor& a, const Actor& b) { return a.position.y < b.position.y; });
 	template<typename CompareFunc>
 	void Sort(CompareFunc compare) {
+		PoolSort::Sort(objs, handles, count, compare);
+		PoolSort::RebuildErase(handles, erase, 0, count);
+	}
+
+	// Stable LSD radix sort on an unsigned integer key, ascending. O(n), byte passes where all keys match are skipped
+	//
+	// Example usage:
+	//   index.SortByKey([](const AssetEntry& entry) { return entry.id; });
+	template<typename KeyFunc>
+	void SortByKey(KeyFunc getKey) {
 		if (count <= 1) return;
-		
-		QuickSort(0, count - 1, compare);
+
+		// Scratch buffers are per pool type, so sorting isn't reentrant across threads
+		static u64 keyBuffers[2][capacity];
+		static THandle handleBuffer[capacity];
+
+		PoolSort::RadixSortByKey(objs, handles, count, getKey, keyBuffers[0], keyBuffers[1], handleBuffer);
+		PoolSort::RebuildErase(handles, erase, 0, count);
 	}
 
-private:
+	// Adds an object at its sorted position in a pool already sorted with the same comparison function.
+	// Binary search plus shifting the handles after the insertion point, the objects don't move
 	template<typename CompareFunc>
-	void QuickSort(u32 low, u32 high, CompareFunc compare) {
-		if (low < high) {
-			u32 pivot = Partition(low, high, compare);
-			if (pivot > low) QuickSort(low, pivot - 1, compare);
-			if (pivot < high) QuickSort(pivot + 1, high, compare);
+	THandle InsertSorted(const T& proto, CompareFunc compare) {
+		const THandle handle = Add(proto);
+		if (handle != THandle::Null()) {
+			const u32 position = PoolSort::MoveToSortedPosition(objs, handles, count, compare);
+			PoolSort::RebuildErase(handles, erase, position, count);
 		}
+		return handle;
 	}
+};
 
-	template<typename CompareFunc>
-	u32 Partition(u32 low, u32 high, CompareFunc compare) {
-		// Use the object at the high position as pivot
-		const T& pivot = objs[handles[high].Index()];
-		u32 i = low;
+// Pool with runtime capacity allocated from an arena. Grows by doubling when full; the old arrays stay
+// in the arena until it's cleared, so prefer a sensible initial capacity.
+// Growing moves the objects, so pointers returned by Get are only valid until the next Add
+template<typename T, typename THandle = PoolHandle<T>>
+class DynamicPool
+{
+private:
+	Arena* pArena;
+	T* objs;
+	THandle* handles;
+	u32* erase;
 
-		for (u32 j = low; j < high; j++) {
-			const T& current = objs[handles[j].Index()];
-			if (compare(current, pivot)) {
-				SwapPoolElements(i, j);
-				i++;
+	u32 count;
+	u32 staleCount;
+	u32 capacity;
+
+	bool GetArrayIndex(const THandle handle, u32& index) const {
+		if (handle == THandle::Null()) {
+			return false;
+		}
+
+		const u32 arrayIndex = handle.Index();
+		if (arrayIndex >= capacity) {
+			return false;
+		}
+
+		const u32 handleIndex = erase[arrayIndex];
+		if (handleIndex >= count || handles[handleIndex] != handle) {
+			return false;
+		}
+
+		index = arrayIndex;
+		return true;
+	}
+
+public:
+	// Grows to at least newCapacity, moving the objects
+	bool Reserve(u32 newCapacity) {
+		if (newCapacity <= capacity) {
+			return true;
+		}
+
+		T* newObjs = (T*)pArena->Push(sizeof(T) * newCapacity, alignof(T), "DynamicPool");
+		THandle* newHandles = (THandle*)pArena->Push(sizeof(THandle) * newCapacity, alignof(THandle), "DynamicPool");
+		u32* newErase = (u32*)pArena->Push(sizeof(u32) * newCapacity, alignof(u32), "DynamicPool");
+		if (!newObjs || !newHandles || !newErase) {
+			return false;
+		}
+
+		if (capacity > 0) {
+			memcpy(newHandles, handles, sizeof(THandle) * capacity);
+			memcpy(newErase, erase, sizeof(u32) * capacity);
+			for (u32 i = 0; i < count; i++) {
+				const u32 arrayIndex = handles[i].Index();
+				newObjs[arrayIndex] = objs[arrayIndex];
 			}
 		}
-		SwapPoolElements(i, high);
-		return i;
+
+		for (u32 i = capacity; i < newCapacity; i++) {
+			newHandles[i] = THandle(i, 1);
+			newErase[i] = i;
+		}
+
+		objs = newObjs;
+		handles = newHandles;
+		erase = newErase;
+		capacity = newCapacity;
+		return true;
 	}
 
-	void SwapPoolElements(u32 a, u32 b) {
-		if (a == b) return;
+	DynamicPool() : pArena(nullptr), objs(nullptr), handles(nullptr), erase(nullptr), count(0), staleCount(0), capacity(0) {}
+	DynamicPool(const DynamicPool& other) = delete;
+	DynamicPool& operator=(const DynamicPool& other) = delete;
 
-		// Swap handles
-		THandle tempHandle = handles[a];
-		handles[a] = handles[b];
-		handles[b] = tempHandle;
+	void Init(Arena* arena, u32 initialCapacity) {
+		static_assert(std::is_trivially_copyable<T>::value, "Type must be trivially copyable");
+
+		pArena = arena;
+		objs = nullptr;
+		handles = nullptr;
+		erase = nullptr;
+		count = 0;
+		staleCount = 0;
+		capacity = 0;
+		Reserve(initialCapacity);
+	}
+
+	// Copies the live objects of another pool, growing if needed. Handles from the other pool stay valid in this one
+	bool CopyFrom(const DynamicPool& other) {
+		if (this == &other || !Reserve(other.capacity)) {
+			return false;
+		}
 
-		// Update erase mappings
-		erase[handles[a].Index()] = a;
-		erase[handles[b].Index()] = b;
+		memcpy(handles, other.handles, sizeof(THandle) * other.capacity);
+		memcpy(erase, other.erase, sizeof(u32) * other.capacity);
+		for (u32 i = other.capacity; i < capacity; i++) {
+			handles[i] = THandle(i, 1);
+			erase[i] = i;
+		}
+
+		count = other.count;
+		staleCount = other.staleCount;
+		for (u32 i = 0; i < count; i++) {
+			const u32 arrayIndex = handles[i].Index();
+			objs[arrayIndex] = other.objs[arrayIndex];
+		}
+		return true;
 	}
-};
\ No newline at end of file
+
+	T* Get(const THandle handle) {
+		u32 arrayIndex;
+		if (!GetArrayIndex(handle, arrayIndex)) {
+			return nullptr;
+		}
+
+		return &objs[arrayIndex];
+	}
+	const T* Get(const THandle handle) const {
+		u32 arrayIndex;
+		if (!GetArrayIndex(handle, arrayIndex)) {
+			return nullptr;
+		}
+
+		return &objs[arrayIndex];
+	}
+	T* operator[](THandle handle) {
+		return Get(handle);
+	}
+	THandle Add() {
+		if (count >= capacity && !Reserve(capacity ? capacity * 2 : 16)) {
+			return THandle::Null();
+		}
+
+		THandle handle = handles[count];
+		if (count < staleCount) {
+			handle = THandle(handle.Index(), handle.Generation() + 1);
+			handles[count] = handle;
+		}
+
+		if (++count >= staleCount) {
+			staleCount = 0;
+		}
+		return handle;
+	}
+	THandle Add(const T& proto) {
+		THandle handle = Add();
+		if (handle != THandle::Null()) {
+			*Get(handle) = proto;
+		}
+		return handle;
+	}
+	bool Remove(const THandle handle) {
+		u32 arrayIndex;
+		if (!GetArrayIndex(handle, arrayIndex)) {
+			return false;
+		}
+
+		const u32 handleIndex = erase[arrayIndex];
+
+		// Same swap-remove as Pool
+		handles[handleIndex] = handles[--count];
+		handles[count] = THandle(arrayIndex, handle.Generation() + 1);
+
+		const u32 swapIndex = handles[handleIndex].Index();
+		erase[arrayIndex] = erase[swapIndex];
+		erase[swapIndex] = handleIndex;
+
+		return true;
+	}
+	bool Contains(const THandle handle) const {
+		u32 index;
+		return GetArrayIndex(handle, index);
+	}
+	u32 Count() const {
+		return count;
+	}
+	u32 Capacity() const {
+		return capacity;
+	}
+	THandle GetHandle(u32 index) const {
+		if (index >= count) {
+			return THandle::Null();
+		}
+		return handles[index];
+	}
+	// Dense access without a generation check, index must be less than Count()
+	T& GetDense(u32 index) {
+		return objs[handles[index].Index()];
+	}
+	const T& GetDense(u32 index) const {
+		return objs[handles[index].Index()];
+	}
+	PoolIterator<DynamicPool, T> begin() {
+		return PoolIterator<DynamicPool, T>(this, 0);
+	}
+	PoolIterator<const DynamicPool, const T> begin() const {
+		return PoolIterator<const DynamicPool, const T>(this, 0);
+	}
+	PoolIteratorEnd end() const {
+		return PoolIteratorEnd{};
+	}
+	void Clear() {
+		if (count > staleCount) {
+			staleCount = count;
+		}
+		count = 0;
+	}
+
+	// Same as Pool::Sort
+	template<typename CompareFunc>
+	void Sort(CompareFunc compare) {
+		PoolSort::Sort(objs, handles, count, compare);
+		PoolSort::RebuildErase(handles, erase, 0, count);
+	}
+
+	// Same as Pool::SortByKey, with the scratch buffers taken from the top of the pool's arena
+	template<typename KeyFunc>
+	bool SortByKey(KeyFunc getKey) {
+		if (count <= 1) return true;
+
+		const ArenaMarker marker = pArena->GetMarker();
+		u64* pKeys = (u64*)pArena->Push(sizeof(u64) * count * 2, alignof(u64), "DynamicPool sort");
+		THandle* pTempHandles = (THandle*)pArena->Push(sizeof(THandle) * count, alignof(THandle), "DynamicPool sort");
+		if (!pKeys || !pTempHandles) {
+			pArena->PopToMarker(marker);
+			return false;
+		}
+
+		PoolSort::RadixSortByKey(objs, handles, count, getKey, pKeys, pKeys + count, pTempHandles);
+		PoolSort::RebuildErase(handles, erase, 0, count);
+		pArena->PopToMarker(marker);
+		return true;
+	}
+
+	// Same as Pool::InsertSorted
+	template<typename CompareFunc>
+	THandle InsertSorted(const T& proto, CompareFunc compare) {
+		const THandle handle = Add(proto);
+		if (handle != THandle::Null()) {
+			const u32 position = PoolSort::MoveToSortedPosition(objs, handles, count, compare);
+			PoolSort::RebuildErase(handles, erase, position, count);
+		}
+		return handle;
+	}
+};
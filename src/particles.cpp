@@ -0,0 +1,349 @@
+#include "particles.h"
+#include "actors.h"
+#include "actor_commands.h"
+#include "game.h"
+#include "game_rendering.h"
+#include "asset_manager.h"
+#include "audio.h"
+#include "memory_arena.h"
+#include <cstdio>
+#include <cstring>
+
+// Struct of arrays so the motion passes can be vectorized
+struct ParticleSystem {
+	u32 count;
+
+	alignas(32) r32 posX[MAX_PARTICLE_COUNT];
+	alignas(32) r32 posY[MAX_PARTICLE_COUNT];
+	alignas(32) r32 velX[MAX_PARTICLE_COUNT];
+	alignas(32) r32 velY[MAX_PARTICLE_COUNT];
+	alignas(32) r32 gravity[MAX_PARTICLE_COUNT];
+	alignas(32) r32 maxFallSpeed[MAX_PARTICLE_COUNT];
+	alignas(32) r32 drag[MAX_PARTICLE_COUNT];
+	alignas(32) r32 swayAmplitude[MAX_PARTICLE_COUNT];
+
+	alignas(32) u16 lifetime[MAX_PARTICLE_COUNT];
+	alignas(32) u16 initialLifetime[MAX_PARTICLE_COUNT];
+
+	// Animation
+	bool animate[MAX_PARTICLE_COUNT];
+	u16 frameIndex[MAX_PARTICLE_COUNT];
+	u16 animCounter[MAX_PARTICLE_COUNT];
+	u16 frameCount[MAX_PARTICLE_COUNT];
+	u8 frameLength[MAX_PARTICLE_COUNT];
+	s16 loopPoint[MAX_PARTICLE_COUNT];
+	AnimationHandle anim[MAX_PARTICLE_COUNT];
+
+	TActorSubtype subtype[MAX_PARTICLE_COUNT];
+	u8 layer[MAX_PARTICLE_COUNT];
+	Damage damage[MAX_PARTICLE_COUNT];
+};
+
+struct ParticleMotion {
+	r32 gravity;
+	r32 maxFallSpeed;
+	r32 drag; // Fraction of velocity lost per frame
+	bool sway; // Horizontal velocity follows a sine wave scaled by the initial velocity
+	bool animate;
+	u8 layer;
+};
+
+constexpr r32 swayTimeMultiplier = 1 / 30.f;
+
+constexpr ParticleMotion particleMotionTable[EFFECT_TYPE_COUNT] = {
+	{ 0.0f, 0.0f, 0.0f, false, false, SPRITE_LAYER_UI }, // Numbers
+	{ 0.0f, 0.0f, 0.0f, false, true, SPRITE_LAYER_FX }, // Explosion
+	{ 0.005f, 0.03125f, 0.0f, true, false, SPRITE_LAYER_FX }, // Feather
+};
+
+static ParticleSystem g_particles;
+
+static void CopyParticle(u32 dst, u32 src) {
+	ParticleSystem& p = g_particles;
+	p.posX[dst] = p.posX[src];
+	p.posY[dst] = p.posY[src];
+	p.velX[dst] = p.velX[src];
+	p.velY[dst] = p.velY[src];
+	p.gravity[dst] = p.gravity[src];
+	p.maxFallSpeed[dst] = p.maxFallSpeed[src];
+	p.drag[dst] = p.drag[src];
+	p.swayAmplitude[dst] = p.swayAmplitude[src];
+	p.lifetime[dst] = p.lifetime[src];
+	p.initialLifetime[dst] = p.initialLifetime[src];
+	p.animate[dst] = p.animate[src];
+	p.frameIndex[dst] = p.frameIndex[src];
+	p.animCounter[dst] = p.animCounter[src];
+	p.frameCount[dst] = p.frameCount[src];
+	p.frameLength[dst] = p.frameLength[src];
+	p.loopPoint[dst] = p.loopPoint[src];
+	p.anim[dst] = p.anim[src];
+	p.subtype[dst] = p.subtype[src];
+	p.layer[dst] = p.layer[src];
+	p.damage[dst] = p.damage[src];
+}
+
+// Calls itoa, but adds a plus sign if value is positive
+static size_t ItoaSigned(s16 value, char* str) {
+	s32 i = 0;
+	if (value > 0) {
+		str[i++] = '+';
+	}
+
+	sprintf(str + i, "%d", value);
+
+	return strlen(str);
+}
+
+static bool ParticleIndexValid(s32 index) {
+	return index >= 0 && u32(index) < g_particles.count;
+}
+
+#pragma region Public API
+s32 Game::SpawnParticle(const ActorPrototypeHandle& prototypeHandle, const glm::vec2& position, const glm::vec2& velocity) {
+	// The index isn't known until the command is applied, so per-particle data can't be set from workers
+	if (ActorCommandsDeferred()) {
+		PushActorCommand({ .type = ACTOR_COMMAND_SPAWN_EFFECT, .id = prototypeHandle.id, .position = position, .velocity = velocity });
+		return PARTICLE_INDEX_NONE;
+	}
+
+	ParticleSystem& p = g_particles;
+	if (p.count >= MAX_PARTICLE_COUNT) {
+		return PARTICLE_INDEX_NONE;
+	}
+
+	const ActorPrototype* pPrototype = AssetManager::GetAsset(prototypeHandle);
+	if (!pPrototype || pPrototype->type != ACTOR_TYPE_EFFECT) {
+		return PARTICLE_INDEX_NONE;
+	}
+
+	const EffectData& effect = pPrototype->data.effect;
+	const ParticleMotion& motion = particleMotionTable[pPrototype->subtype];
+
+	const u32 i = p.count++;
+	p.posX[i] = position.x;
+	p.posY[i] = position.y;
+	p.velX[i] = velocity.x;
+	p.velY[i] = velocity.y;
+	p.gravity[i] = motion.gravity;
+	p.maxFallSpeed[i] = motion.maxFallSpeed;
+	p.drag[i] = motion.drag;
+	p.swayAmplitude[i] = motion.sway ? velocity.x : 0.0f;
+	p.lifetime[i] = effect.lifetime;
+	p.initialLifetime[i] = effect.lifetime;
+	p.subtype[i] = pPrototype->subtype;
+	p.layer[i] = motion.layer;
+	p.damage[i] = Damage{};
+
+	p.animate[i] = false;
+	p.frameIndex[i] = 0;
+	p.animCounter[i] = 0;
+	p.frameCount[i] = 0;
+	p.frameLength[i] = 0;
+	p.loopPoint[i] = -1;
+	p.anim[i] = AnimationHandle::Null();
+
+	if (pPrototype->animCount > 0) {
+		const AnimationHandle animHandle = pPrototype->GetAnimations()[0];
+		const Animation* pAnim = AssetManager::GetAsset(animHandle);
+		if (pAnim) {
+			p.anim[i] = animHandle;
+			p.frameCount[i] = pAnim->frameCount;
+			p.frameLength[i] = pAnim->frameLength;
+			p.loopPoint[i] = pAnim->loopPoint;
+			p.animate[i] = motion.animate;
+		}
+	}
+
+	if (effect.sound != SoundHandle::Null()) {
+		Audio::PlaySFX(effect.sound);
+	}
+
+	return s32(i);
+}
+
+void Game::SpawnEffect(const ActorPrototypeHandle& prototypeHandle, const glm::vec2& position, const glm::vec2& velocity) {
+	if (ActorCommandsDeferred()) {
+		PushActorCommand({ .type = ACTOR_COMMAND_SPAWN_EFFECT, .id = prototypeHandle.id, .position = position, .velocity = velocity });
+		return;
+	}
+
+	// Effects are dropped when the particle pool is full, other prototypes still spawn as actors
+	const ActorPrototype* pPrototype = AssetManager::GetAsset(prototypeHandle);
+	if (pPrototype && pPrototype->type == ACTOR_TYPE_EFFECT) {
+		SpawnParticle(prototypeHandle, position, velocity);
+		return;
+	}
+
+	SpawnActor(prototypeHandle, position, velocity);
+}
+
+void Game::SetParticleDamage(s32 index, const Damage& damage) {
+	if (ParticleIndexValid(index)) {
+		g_particles.damage[index] = damage;
+	}
+}
+
+void Game::SetParticleFrame(s32 index, u16 frameIndex) {
+	if (ParticleIndexValid(index) && frameIndex < g_particles.frameCount[index]) {
+		g_particles.frameIndex[index] = frameIndex;
+	}
+}
+
+u16 Game::GetParticleFrameCount(s32 index) {
+	return ParticleIndexValid(index) ? g_particles.frameCount[index] : 0;
+}
+
+u32 Game::GetParticleCount() {
+	return g_particles.count;
+}
+
+void Game::UpdateParticles() {
+	ParticleSystem& p = g_particles;
+	const u32 count = p.count;
+
+	for (u32 i = 0; i < count; i++) {
+		p.lifetime[i] -= p.lifetime[i] > 0 ? 1 : 0;
+	}
+
+	for (u32 i = 0; i < count; i++) {
+		const r32 velY = (p.velY[i] + p.gravity[i]) * (1.0f - p.drag[i]);
+		// Particles without a max fall speed are unclamped
+		p.velY[i] = p.maxFallSpeed[i] > 0.0f ? glm::min(velY, p.maxFallSpeed[i]) : velY;
+		p.velX[i] *= 1.0f - p.drag[i];
+	}
+
+	for (u32 i = 0; i < count; i++) {
+		if (p.swayAmplitude[i] == 0.0f) {
+			continue;
+		}
+
+		const u16 time = p.initialLifetime[i] - p.lifetime[i];
+		p.velX[i] = p.swayAmplitude[i] * glm::sin(time * swayTimeMultiplier);
+	}
+
+	for (u32 i = 0; i < count; i++) {
+		p.posX[i] += p.velX[i];
+		p.posY[i] += p.velY[i];
+	}
+
+	for (u32 i = 0; i < count; i++) {
+		if (!p.animate[i]) {
+			continue;
+		}
+
+		AdvanceAnimation(p.animCounter[i], p.frameIndex[i], p.frameCount[i], p.frameLength[i], p.loopPoint[i]);
+	}
+
+	// Compact dead particles by swapping in the last one
+	u32 i = 0;
+	while (i < p.count) {
+		if (p.lifetime[i] == 0) {
+			CopyParticle(i, --p.count);
+			continue;
+		}
+		i++;
+	}
+}
+
+void Game::DrawParticles() {
+	const ParticleSystem& p = g_particles;
+
+	// Consecutive particles drawing the same metasprite are emitted as one batch.
+	// Pushed on the arena directly, the allocator would log the allocation every frame
+	Arena* pFrameArena = ArenaAllocator::GetArena(ARENA_PER_FRAME);
+	glm::i16vec2* batchPositions = (glm::i16vec2*)pFrameArena->Push(sizeof(glm::i16vec2) * (p.count ? p.count : 1), alignof(glm::i16vec2), "Particle batch");
+	if (!batchPositions) {
+		return;
+	}
+	u32 batchCount = 0;
+	MetaspriteHandle batchMetasprite = MetaspriteHandle::Null();
+	u8 batchLayer = 0;
+
+	AnimationHandle cachedAnimHandle = AnimationHandle::Null();
+	const Animation* pCachedAnim = nullptr;
+
+	for (u32 i = 0; i < p.count; i++) {
+		const glm::vec2 position = { p.posX[i], p.posY[i] };
+		if (!Rendering::PositionInViewportBounds(position)) {
+			continue;
+		}
+
+		if (p.subtype[i] == EFFECT_TYPE_NUMBERS) {
+			DrawDamageNumbers(p.damage[i], position);
+			continue;
+		}
+
+		if (p.anim[i] != cachedAnimHandle) {
+			cachedAnimHandle = p.anim[i];
+			pCachedAnim = AssetManager::GetAsset(cachedAnimHandle);
+		}
+
+		if (!pCachedAnim || p.frameIndex[i] >= pCachedAnim->frameCount) {
+			continue;
+		}
+
+		const MetaspriteHandle metaspriteHandle = pCachedAnim->GetFrames()[p.frameIndex[i]].metaspriteId;
+		if (batchCount > 0 && (metaspriteHandle != batchMetasprite || p.layer[i] != batchLayer)) {
+			Rendering::DrawMetaspriteBatch(batchLayer, batchMetasprite, batchPositions, batchCount);
+			batchCount = 0;
+		}
+
+		batchMetasprite = metaspriteHandle;
+		batchLayer = p.layer[i];
+		batchPositions[batchCount++] = Rendering::WorldPosToScreenPixels(position);
+	}
+
+	if (batchCount > 0) {
+		Rendering::DrawMetaspriteBatch(batchLayer, batchMetasprite, batchPositions, batchCount);
+	}
+}
+
+void Game::ClearParticles() {
+	g_particles.count = 0;
+}
+
+bool Game::DrawDamageNumbers(const Damage& damage, const glm::vec2& position) {
+	static char numberStr[16]{};
+
+	s16 value = damage.value;
+	if (!damage.flags.healing) {
+		value *= -1;
+	}
+	const u8 strLength = (u8)ItoaSigned(value, numberStr);
+
+	// Ascii character '*' = 0x2A
+	constexpr u8 chrOffset = 0x2A;
+	constexpr u16 chrWidth = 6;
+	const u8 palette = damage.flags.healing ? 0x3 : 0x1;
+
+	const glm::i16vec2 pixelPos = Rendering::WorldPosToScreenPixels(position);
+
+	const s16 widthPx = strLength * chrWidth;
+	const s16 xStart = pixelPos.x - widthPx / 2;
+
+	bool result = true;
+	for (u8 i = 0; i < strLength; i++) {
+		Sprite sprite{};
+		sprite.tileId = 0x90 + numberStr[i] - chrOffset;
+		sprite.palette = palette;
+		sprite.x = xStart + i * chrWidth;
+		sprite.y = pixelPos.y;
+		result &= Rendering::DrawSprite(SPRITE_LAYER_UI, GetConfig().uiBankHandle, sprite);
+	}
+
+	if (damage.flags.crit) {
+		const s16 xCrit = pixelPos.x - chrWidth * 2;
+		const s16 yCrit = pixelPos.y - TILE_DIM_PIXELS;
+		for (u32 i = 0; i < 4; i++) {
+			Sprite sprite{};
+			sprite.tileId = 0xa0 + i;
+			sprite.palette = palette;
+			sprite.x = xCrit + i * chrWidth;
+			sprite.y = yCrit;
+			result &= Rendering::DrawSprite(SPRITE_LAYER_UI, GetConfig().uiBankHandle, sprite);
+		}
+	}
+
+	return result;
+}
+#pragma endregion
@@ -0,0 +1,25 @@
+#pragma once
+#include "typedef.h"
+#include "actor_data.h"
+#include <glm.hpp>
+
+constexpr u32 MAX_PARTICLE_COUNT = 1024;
+constexpr s32 PARTICLE_INDEX_NONE = -1;
+
+namespace Game {
+	// Spawns a particle from an effect prototype. Returns the particle index, which is only valid until the next UpdateParticles call
+	s32 SpawnParticle(const ActorPrototypeHandle& prototypeHandle, const glm::vec2& position, const glm::vec2& velocity = { 0.0f, 0.0f });
+	// Spawns a particle if the prototype is an effect, otherwise an actor
+	void SpawnEffect(const ActorPrototypeHandle& prototypeHandle, const glm::vec2& position, const glm::vec2& velocity = { 0.0f, 0.0f });
+
+	void SetParticleDamage(s32 index, const Damage& damage);
+	void SetParticleFrame(s32 index, u16 frameIndex);
+	u16 GetParticleFrameCount(s32 index);
+
+	u32 GetParticleCount();
+	void UpdateParticles();
+	void DrawParticles();
+	void ClearParticles();
+
+	bool DrawDamageNumbers(const Damage& damage, const glm::vec2& position);
+}
@@ -1,12 +1,12 @@
 #include "actors.h"
 #include "game_rendering.h"
 #include "game_state.h"
-#include "audio.h"
+#include "actor_commands.h"
 
 static void OnPickup(Actor* pActor) {
     pActor->flags.pendingRemoval = true;
     if (pActor->data.pickup.pickupSound != SoundHandle::Null()) {
-        Audio::PlaySFX(pActor->data.pickup.pickupSound, 0);
+        Game::PlayActorSFX(pActor->data.pickup.pickupSound, 0);
     }
 }
 
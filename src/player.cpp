@@ -1,4 +1,5 @@
 #include "actors.h"
+#include "actor_commands.h"
 #include "game_rendering.h"
 #include "game_input.h"
 #include "game_state.h"
@@ -6,6 +7,7 @@
 #include "audio.h"
 #include "asset_manager.h"
 #include "tilemap.h"
+#include "particles.h"
 
 enum PlayerAnimation : u8 {
     PLAYER_ANIM_IDLE = 0,
@@ -209,10 +211,10 @@ static void SpawnFeathers(Actor* pPlayer, u32 count) {
         };
 
         const glm::vec2 velocity = Random::GenerateDirection() * 0.0625f;
-        Actor* pSpawned = Game::SpawnActor(featherPrototypeId, pPlayer->position + spawnOffset, velocity);
-        const Animation* pSpawnedCurrentAnim = Game::GetActorCurrentAnim(pSpawned);
-        if (pSpawnedCurrentAnim) {
-            pSpawned->drawState.frameIndex = Random::GenerateInt(0, pSpawnedCurrentAnim->frameCount - 1);
+        const s32 particleIndex = Game::SpawnParticle(featherPrototypeId, pPlayer->position + spawnOffset, velocity);
+        const u16 frameCount = Game::GetParticleFrameCount(particleIndex);
+        if (frameCount > 0) {
+            Game::SetParticleFrame(particleIndex, Random::GenerateInt(0, frameCount - 1));
         }
     }
 }
@@ -700,13 +702,7 @@ static s16 GetWingsVerticalOffset(const Actor* pPlayer) {
         pPlayer->data.player.flags.mode == PLAYER_MODE_STAND_TO_SIT ||
         pPlayer->data.player.flags.mode == PLAYER_MODE_SIT_TO_STAND) {
 
-        const ActorPrototype* pPrototype = AssetManager::GetAsset(pPlayer->__temp_actorPrototypeHandle);
-        if (!pPrototype) {
-            return vOffset;
-        }
-
-		AnimationHandle animHandle = pPrototype->GetAnimations()[pPlayer->drawState.animIndex];
-        const Animation* pAnim = AssetManager::GetAsset(animHandle);
+        const Animation* pAnim = Game::GetActorCurrentAnim(pPlayer);
         if (pAnim) {
 			r32 animProgress = pPlayer->drawState.frameIndex / (r32)pAnim->frameCount;
             if (pPlayer->data.player.flags.mode == PLAYER_MODE_SIT_TO_STAND) {
@@ -763,6 +759,10 @@ bool Game::PlayerInvulnerable(Actor* pPlayer) {
 }
 
 void Game::PlayerTakeDamage(Actor* pPlayer, const Damage& damage, const glm::vec2& enemyPos) {
+    if (ActorCommandsDeferred()) {
+        return PushActorCommand({ .type = ACTOR_COMMAND_DAMAGE_PLAYER, .position = enemyPos, .damage = damage });
+    }
+
     u16 health = GetPlayerHealth();
 
     if (pPlayer->data.player.damageSound != SoundHandle::Null()) {
@@ -6,6 +6,11 @@ static std::random_device rd;
 static std::mt19937 gen32(rd());
 static std::mt19937_64 gen64(rd());
 
+void Random::Seed(u64 seed) {
+    gen32.seed((u32)seed);
+    gen64.seed(seed);
+}
+
 u64 Random::GenerateUUID() {
     u64 result = UUID_NULL;
     while (result == UUID_NULL) {
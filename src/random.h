@@ -6,6 +6,9 @@
 constexpr u64 UUID_NULL = 0;
 
 namespace Random {
+	// Makes the sequence reproducible, e.g. for benchmarks
+	void Seed(u64 seed);
+
 	u64 GenerateUUID();
 	u32 GenerateUUID32();
 
@@ -8,9 +8,12 @@
 #include <sstream>
 #include <iomanip>
 #include <functional>
+#include <mutex>
 
 static Slang::ComPtr<slang::IGlobalSession> g_slangGlobalSession = nullptr;
 Slang::ComPtr<slang::ISession> g_slangSession = nullptr;
+// Sessions aren't thread safe, and assets can be loaded from multiple threads
+static std::mutex g_slangMutex;
 
 static bool InitSession() {
 	if (g_slangGlobalSession && g_slangSession) {
@@ -62,6 +65,7 @@ static bool InitSession() {
 }
 
 bool ShaderCompiler::Compile(const char* name, const char* path, const char* source, std::vector<u8>& outData) {
+	std::lock_guard<std::mutex> lock(g_slangMutex);
 	InitSession();
 
 	slang::IModule *module = g_slangSession->loadModuleFromSourceString(name, path, source);
@@ -17,7 +17,7 @@ s32 Tiles::GetTileIndex(const Tilemap* pTilemap, const glm::ivec2& pos) {
 		return -1;
 	}
 
-    return (pos.x % pTilemap->width) + (pos.y % pTilemap->height) * pTilemap->width;
+    return pos.x + pos.y * pTilemap->width;
 }
 
 s32 Tiles::GetTilesetTileIndex(const Tilemap* pTilemap, const glm::ivec2& pos) {
@@ -1,14 +1,17 @@
 #include <iostream>
 #include <filesystem>
+#include <cstring>
 #include "../asset_archive.h"
 #include "../asset_serialization.h"
 #include "../shader_compiler.h"
 #include <fstream>
+#include <atomic>
 
 namespace fs = std::filesystem;
 
 // TODO: Remove copypasta from AssetManager
-bool PackAssetsFromDirectory(AssetArchive& archive, const fs::path& directory) {
+// With a cache directory, assets whose source and metadata haven't changed are taken from the cache instead of being serialized again
+bool PackAssetsFromDirectory(AssetArchive& archive, const fs::path& directory, const fs::path& cacheDirectory) {
 	if (!std::filesystem::exists(directory)) {
 		std::cerr << "Directory (" << directory.string() << ") does not exist" << std::endl;
 		return false;
@@ -21,43 +24,89 @@ bool PackAssetsFromDirectory(AssetArchive& archive, const fs::path& directory) {
 
 	std::cout << "Packing assets from directory: " << directory.string() << std::endl;
 
-	std::vector<u8> data;
-	for (const auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
-		AssetType assetType;
-		if (entry.is_regular_file() && AssetSerialization::TryGetAssetTypeFromPath(entry.path(), assetType) == SERIALIZATION_SUCCESS) {
-			const std::string pathStr = entry.path().string();
-			const char* pathCStr = pathStr.c_str();
-			std::cout << "Found " << ASSET_TYPE_NAMES[assetType] << ": " << pathCStr << std::endl;
-
-			nlohmann::json metadata;
-			if (AssetSerialization::LoadAssetMetadataFromFile(entry.path(), metadata) != SERIALIZATION_SUCCESS) {
-				std::cerr << "Failed to load metadata for asset " << pathCStr << std::endl;
-				continue;
-			}
-
-			const u64 guid = metadata["guid"];
-
-			data.clear();
-			if (AssetSerialization::LoadAssetFromFile(entry.path(), assetType, metadata, data) != SERIALIZATION_SUCCESS) {
-				std::cerr << "Failed to load asset data from " << pathCStr << std::endl;
-				continue;
-			}
-
-			const std::filesystem::path relativePath = std::filesystem::relative(entry.path(), directory);
-			if (!archive.AddAsset(guid, assetType, data.size(), relativePath.string().c_str(),  data.data())) {
-				std::cerr << "Failed to add asset " << pathCStr << " to archive" << std::endl;
-				continue;
-			}
-			std::cout << "Asset " << pathCStr << " packed successfully with GUID: " << guid << std::endl;
+	std::vector<AssetSerialization::AssetSource> sources;
+	AssetSerialization::FindAssetSources(directory, sources);
+
+	// Source file sizes are close enough to the serialized sizes to reserve storage up front
+	size_t estimatedSize = 0;
+	for (const AssetSerialization::AssetSource& source : sources) {
+		estimatedSize += source.fileSize;
+	}
+	archive.BeginBulkAdd((u32)sources.size(), estimatedSize);
+
+	const bool useCache = !cacheDirectory.empty();
+	std::atomic<u32> cachedCount = 0;
+	u32 packedCount = 0;
+
+	auto loadAsset = [&](const AssetSerialization::AssetSource& source, u64& outId, std::vector<u8>& outData) {
+		if (!useCache) {
+			return AssetSerialization::LoadAsset(source, outId, outData);
+		}
+
+		bool fromCache;
+		const SerializationResult result = AssetSerialization::LoadAssetCached(source, cacheDirectory, outId, outData, fromCache);
+		if (fromCache) {
+			cachedCount++;
+		}
+		return result;
+	};
+
+	auto addAsset = [&](const AssetSerialization::AssetSource& source, SerializationResult result, u64 guid, const u8* pData, size_t size) {
+		const std::string pathStr = source.path.string();
+		const char* pathCStr = pathStr.c_str();
+		std::cout << "Found " << ASSET_TYPE_NAMES[source.type] << ": " << pathCStr << std::endl;
+
+		if (result == SERIALIZATION_INVALID_METADATA) {
+			std::cerr << "Failed to load metadata for asset " << pathCStr << std::endl;
+			return;
+		}
+		if (result != SERIALIZATION_SUCCESS) {
+			std::cerr << "Failed to load asset data from " << pathCStr << std::endl;
+			return;
+		}
+
+		const std::filesystem::path relativePath = std::filesystem::relative(source.path, directory);
+		if (!archive.AddAsset(guid, source.type, size, relativePath.string().c_str(), pData)) {
+			std::cerr << "Failed to add asset " << pathCStr << " to archive" << std::endl;
+			return;
 		}
+		packedCount++;
+		std::cout << "Asset " << pathCStr << " packed successfully with GUID: " << guid << std::endl;
+	};
+
+	AssetSerialization::LoadAssetsParallel(sources, loadAsset, addAsset);
+
+	archive.EndBulkAdd();
+
+	if (useCache) {
+		std::cout << packedCount - cachedCount << " assets rebuilt, " << cachedCount << " taken from the cache" << std::endl;
 	}
 
+	if (!archive.RebuildDependencies(AssetSerialization::GetAssetDependencies, ASSET_TYPE_DUNGEON)) {
+		std::cerr << "Failed to build asset dependencies" << std::endl;
+		return false;
+	}
 	return true;
 }
 
 int main(int argc, char* argv[]) {
-	if (argc != 3) {
-		std::cerr << "Usage: " << argv[0] << " <assets_dir> <output_file>" << std::endl;
+	bool compress = false;
+	fs::path cacheDir;
+	bool validArgs = argc >= 3;
+	for (int i = 3; i < argc && validArgs; i++) {
+		if (strcmp(argv[i], "--compress") == 0) {
+			compress = true;
+		}
+		else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+			cacheDir = argv[++i];
+		}
+		else {
+			validArgs = false;
+		}
+	}
+
+	if (!validArgs) {
+		std::cerr << "Usage: " << argv[0] << " <assets_dir> <output_file> [--compress] [--cache <cache_dir>]" << std::endl;
 		return 1;
 	}
 
@@ -67,12 +116,12 @@ int main(int argc, char* argv[]) {
 	std::cout << "Asset Packer - Generating " << outputFile << " from " << assetsDir << std::endl;
 
 	AssetArchive archive;
-	if (!PackAssetsFromDirectory(archive, assetsDir)) {
+	if (!PackAssetsFromDirectory(archive, assetsDir, cacheDir)) {
 		std::cerr << "Failed to pack assets from " << assetsDir << std::endl;
 		return 1;
 	}
 	
-	if (!archive.SaveToFile(outputFile)) {
+	if (!archive.SaveToFile(outputFile, compress)) {
 		std::cerr << "Failed to save assets to " << outputFile << std::endl;
 		return 1;
 	}